@@ -4,18 +4,29 @@
 
 using namespace edge::backtracker;
 
-const int ANY_COLOR = 0xFF;
+static const int64_t CHECKPOINT_KIND = 0x44594e34; // "DYN4"
+
+static bool HasDepth(const uint64_t* set, int depth)
+{
+    return ((set[depth / 64] >> (depth % 64)) & 1) != 0;
+}
+
+static void AddDepth(uint64_t* set, int depth)
+{
+    set[depth / 64] |= 1ull << (depth % 64);
+}
 
 Backtracker::Backtracker(Board& board, std::set<std::pair<int, int>>* pieces_map, bool find_all,
-    const std::string& rotations_file)
-    : board(board),
-    find_all(find_all), connecting(true),
-    highest_score(0)
+    const std::string& rotations_file, CandidateEngine engine)
+    : board(board), state(State::SEARCHING), engine(engine), retry(nullptr),
+    backjumping(false), find_all(find_all),
+    highest_score(0), reported(false), on_split(nullptr), split_depth(0)
 {
+    std::vector<Board::Loc*> unvisited;
     for (int x = 0; x < board.GetPuzzleDef()->GetHeight(); ++x) {
         for (int y = 0; y < board.GetPuzzleDef()->GetWidth(); ++y) {
             if (!pieces_map || pieces_map->find(std::pair<int, int>(x, y)) != pieces_map->end()) {
-                unvisited.insert(board.GetLocation(x, y));
+                unvisited.push_back(board.GetLocation(x, y));
             }
         }
     }
@@ -38,399 +49,306 @@ Backtracker::Backtracker(Board& board, std::set<std::pair<int, int>>* pieces_map
         }
     }
 
-    for (auto& piece : board.GetPuzzleDef()->GetAll()) {
-        if (!rotations.empty())
-        {
-            unplaced_pieces.insert(board.GetRef(piece.second.id,rotations[piece.second.id]));
-        }
-        else {
-            for (int dir = 0; dir < 4; ++dir) {
-                unplaced_pieces.insert(board.GetRef(piece.second.id,dir));
-            }
-        }
-    }
-
     stats.Init(board);
-    rot_checker.Init(board.GetPuzzleDef());
 
     // hints
     for (auto& hint : board.GetPuzzleDef()->GetHints()) {
         int dir = (hint.dir != -1) ? hint.dir : 0;
         board.PutPiece(hint.id, hint.x, hint.y, dir);
-        rot_checker.Place(board.GetLocation(hint.x, hint.y)->ref->GetPattern(0),
-            board.GetLocation(hint.x, hint.y)->ref->GetPattern(1), 
-            board.GetLocation(hint.x, hint.y)->ref->GetPattern(2), 
-            board.GetLocation(hint.x, hint.y)->ref->GetPattern(3));
-
-        std::vector< PieceRef* > to_erase;
-
-        to_erase.clear();
-        for (auto& ref : unplaced_pieces) {
-            if (ref->GetId() == hint.id) {
-                to_erase.push_back(ref);
-            }
-        }
-        for (auto& ref : to_erase) {
-            unplaced_pieces.erase(ref);
-        }
 
         auto loc = board.GetLocation(hint.x, hint.y);
-        unvisited.erase(loc);
         stack.visited.push(Stack::LevelInfo(loc));
         stack.start_size++;
+        stack.hints_size++;
     }
 
+    rot_checker.Init(board);
+
     highest_score = static_cast<int>(stack.visited.size());
     board.AdjustDirBorder();
 
     // create fast access structure for finding all pieces matching
     // given list of patterns
-    // TBD - following need refactor + fix to work with specific pieces rotation provided
-    for (auto& piece : board.GetPuzzleDef()->GetInner()) {
+    candidates.Init(board.GetPuzzleDef());
+    for (auto& piece : board.GetPuzzleDef()->GetAll()) {
         for (int dir = 0; dir < 4; ++dir) {
-            if (rotations.empty() || rotations[piece.id] == dir)
+            if (rotations.empty() || rotations[piece.first] == dir)
             {
-                auto ref = board.GetRef(piece.id, dir);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ANY_COLOR, ANY_COLOR)].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ANY_COLOR, ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ANY_COLOR, ANY_COLOR)].push_back(ref);
+                candidates.Add(board.GetRef(piece.first, dir));
             }
         }
     }
-
-
-    for (auto& piece : board.GetPuzzleDef()->GetCorners()) 
-    {
-        // corners are of form something, something, 0, 0
-        {
-            if (rotations.empty() || rotations[piece.id] == 0)
-            {
-                auto ref = board.GetRef(piece.id, 0); // something, something, 0, 0
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-            }
+    candidates.Build();
+    frontier.Init(board, candidates, unvisited);
+
+    // depths go from root (1) up to all pieces placed
+    origin = board.GetLocation(-1, -1);
+    depths.assign((board.GetPuzzleDef()->GetHeight() + 2) * (board.GetPuzzleDef()->GetWidth() + 2), 0);
+    piece_depths.assign(board.GetPuzzleDef()->GetPieceCount() + 1, 0);
+    conflict_words = (board.GetPuzzleDef()->GetPieceCount() + 2 + 63) / 64;
+    conflict.assign(conflict_words, 0);
+    conflicts.assign((board.GetPuzzleDef()->GetPieceCount() + 2) * conflict_words, 0);
+
+    if (engine == CandidateEngine::BITSET) {
+        bitsets.Init(board, rotations);
+        for (auto& hint : board.GetPuzzleDef()->GetHints()) {
+            bitsets.Place(board.GetLocation(hint.x, hint.y)->ref);
         }
-
-        {
-            if (rotations.empty() || rotations[piece.id] == 1)
-            {
-                auto ref = board.GetRef(piece.id, 1); // 0, something, something, 0
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-            }
-        }
-
-        {
-            if (rotations.empty() || rotations[piece.id] == 2)
-            {
-                auto ref = board.GetRef(piece.id, 2); // 0, 0, something, something
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ANY_COLOR)].push_back(ref);
-            }
-        }
-
-        {
-            if (rotations.empty() || rotations[piece.id] == 3)
-            {
-                auto ref = board.GetRef(piece.id, 3); // something, 0, 0, something
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-            }
-        }
-
+        matched.resize(bitsets.GetWords());
     }
+}
 
-    for (auto& piece : board.GetPuzzleDef()->GetEdges())
+bool Backtracker::Step()
+{
+    switch (state)
     {
-        // edges are of form something, something, something, 0
-        {
-            if (rotations.empty() || rotations[piece.id] == 0)
-            {
-                auto ref = board.GetRef(piece.id, 0); // something, something, something, 0
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
+    case State::SEARCHING:
+        return Search();
+    case State::BACKTRACKING:
+        Unwind();
+        return true;
+    default:
+        return false;
+    }
+}
 
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-            }
+bool Backtracker::Run(long long node_budget, time_t deadline, long long& nodes)
+{
+    nodes = 0;
+    reported = false;
+    while (nodes < node_budget) {
+        if (state == State::SEARCHING) {
+            Search();
         }
-
-        {
-            if (rotations.empty() || rotations[piece.id] == 1)
-            {
-                auto ref = board.GetRef(piece.id, 1); // 0, something, something, something 
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ANY_COLOR, ANY_COLOR)].push_back(ref);
-            }
+        else if (state == State::BACKTRACKING) {
+            Unwind();
         }
-
-        {
-            if (rotations.empty() || rotations[piece.id] == 2)
-            {
-                auto ref = board.GetRef(piece.id, 2); // something, 0, something, something 
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ANY_COLOR, ANY_COLOR)].push_back(ref);
-            }
+        else {
+            break;
         }
+        ++nodes;
 
-        {
-            if (rotations.empty() || rotations[piece.id] == 3)
-            {
-                auto ref = board.GetRef(piece.id, 3); // something, something, 0, something 
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
+        // let the caller react to solution or new best
+        if (reported) {
+            break;
+        }
 
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-            }
+        if (deadline && nodes % DEADLINE_CHECK_NODES == 0 && time(0) >= deadline) {
+            break;
         }
     }
 
-    // shuffle the neighbour table to give this particular run bit of randomness
-    for (auto& item : neighbour_table) {
-        random_shuffle(item.second.begin(), item.second.end());
-    }
+    return state != State::FINISHED;
 }
 
-int Backtracker::EncodePatterns(int east, int south, int west, int north)
+inline void Backtracker::CheckPlaced()
 {
-    int encoded = east;
-
-    encoded *= ANY_COLOR + 1;
-    encoded += south;
-
-    encoded *= ANY_COLOR + 1;
-    encoded += west;
-
-    encoded *= ANY_COLOR + 1;
-    encoded += north;
+    // if remaining sides cannot match colours of the board, backtrack...
+    if (!rot_checker.CanBeFinished()) {
+        LDEBUG("Inconsistent rotation, initating backtrack...\n");
+        ConflictAll();
+        state = State::BACKTRACKING;
+    }
 
-    return encoded;
+    if (state == State::SEARCHING && on_split &&
+        static_cast<int>(stack.visited.size()) - stack.start_size == split_depth) {
+        // this subtree is searched elsewhere
+        stats.HandOff();
+        on_split->Call(board);
+        ConflictAll();
+        state = State::BACKTRACKING;
+    }
 }
 
-bool Backtracker::Step()
+bool Backtracker::Search()
 {
-    switch (state)
-    {
-    case State::SEARCHING:
-    {
-        if (unvisited.empty()) {
-            for (auto& callback : on_solve) {
-                callback->Call(board);
-            }
+    if (frontier.GetRemaining() == 0) {
+        for (auto& callback : on_solve) {
+            callback->Call(board);
+        }
+        reported = true;
 
-            if (!find_all) {
-                // everything already placed, solved...
-                state = State::FINISHED;
-                return false;
-            }
+        if (!find_all) {
+            // everything already placed, solved...
+            state = State::FINISHED;
+            return false;
         }
 
-        PieceRef* selected_piece = nullptr;
-        Board::Loc* selected_loc = nullptr;
+        ConflictAll();
+        state = State::BACKTRACKING;
+        return true;
+    }
 
-        int best_score = CheckFeasible(selected_loc, selected_piece);
-        if (best_score <= 0) {
-            // impossible to place anything here... backtrack
+    PieceRef* selected_piece = nullptr;
+    Board::Loc* selected_loc = nullptr;
+    int selected_cursor = -1;
+
+    if (retry.loc) {
+        // returned from backtrack, nothing else changed on the board, so the
+        // same location stays most constrained, just advance to next candidate
+        selected_loc = retry.loc;
+        selected_cursor = NextCandidate(retry.loc, retry.cursor, selected_piece);
+        retry.loc = nullptr;
+        if (selected_cursor < 0) {
+            // all candidates tried, the location failed for what failed each of
+            // them and for what excludes the other pieces
+            if (backjumping) {
+                int depth = static_cast<int>(stack.visited.size()) + 1;
+                std::copy(conflicts.begin() + depth * conflict_words,
+                    conflicts.begin() + (depth + 1) * conflict_words, conflict.begin());
+                AddConflict(selected_loc);
+            }
             state = State::BACKTRACKING;
 
             return true;
         }
 
-        Place(selected_loc, selected_piece);
-        unplaced_pieces.erase(selected_piece);
+        Place(selected_loc, selected_piece, selected_cursor);
+        CheckPlaced();
+    }
 
-        // if inconsistent rotations, backtrack...
-        if (!rot_checker.CanBeFinished(selected_piece->GetPattern(0)) ||
-            !rot_checker.CanBeFinished(selected_piece->GetPattern(1)) ||
-            !rot_checker.CanBeFinished(selected_piece->GetPattern(2)) ||
-            !rot_checker.CanBeFinished(selected_piece->GetPattern(3)) ) {
-            LDEBUG("Inconsistent rotation, initating backtrack...\n");
+    // locations with single candidate are filled within the same step, up to
+    // (and including) the next placement having alternatives
+    while (state == State::SEARCHING && frontier.GetRemaining() > 0) {
+        int best_score = CheckFeasible(selected_loc, selected_piece, selected_cursor);
+        if (best_score <= 0) {
+            // impossible to place anything here... backtrack
+            if (backjumping) {
+                if (best_score == 0) {
+                    std::fill(conflict.begin(), conflict.end(), 0);
+                    AddConflict(selected_loc);
+                }
+                else {
+                    ConflictAll();
+                }
+            }
             state = State::BACKTRACKING;
-        }
 
-        return true;
-    }
-    break;
-    case State::BACKTRACKING:
-    {
-        if (Backtrack()) {
-            state = State::SEARCHING;
+            return true;
         }
-        else {
-            // we should now unwrap beyond hint piece if there is any 
-            // this forces all pieces beyound it to be counted properly
-            if (stack.visited.size() > 1) {
-                stats.Update(static_cast<int>(stack.visited.size()) - 1);
-            }
 
-            state = State::FINISHED;
+        Place(selected_loc, selected_piece, selected_cursor);
+        stack.visited.top().forced = (best_score == 1);
+        if (backjumping) {
+            int depth = static_cast<int>(stack.visited.size());
+            std::fill(conflicts.begin() + depth * conflict_words,
+                conflicts.begin() + (depth + 1) * conflict_words, 0);
+        }
+        CheckPlaced();
+        if (best_score > 1) {
+            break;
         }
-    }
-    break;
-    case State::FINISHED:
-    {
-        return false;
-    }
-    break;
-    default:
-        break;
     }
 
     return true;
 }
 
-int Backtracker::CheckFeasible(Board::Loc*& feasible_location,
-    PieceRef*& feasible_piece)
+void Backtracker::Unwind()
 {
-    int best_score = -1;
-
-    PieceRef* selected = nullptr;
-    Board::Loc* selected_loc = nullptr;
-    auto& forbidden_map = stack.visited.top().forbidden;
-    auto& locations_map = board.GetLocations();
-
-    // TBD we should visit unvisited in random order too ...
-    for (auto loc : unvisited) {
-        if ((connecting || loc->type == Board::LocType::INNER) && !stack.IsEmpty()) {
-            // for inner pieces, check if they have any neighbours, otherwise we
-            // are wasting time computing those
-            int neighbours = 0;
-            for (int i = 0; i < 4; ++i) {
-                neighbours += (loc->neighbours[i] && loc->neighbours[i]->ref) ? 1 : 0;
-            }
-            if (neighbours == 0) {
-                continue;
-            }
+    if (!backjumping) {
+        // forced placements are removed together with the choice they follow
+        bool unwound = Backtrack();
+        while (unwound && retry.forced) {
+            unwound = Backtrack();
         }
 
-        auto& east_loc = loc->neighbours[EAST];
-        auto& south_loc = loc->neighbours[SOUTH];
-        auto& west_loc = loc->neighbours[WEST];
-        auto& north_loc = loc->neighbours[NORTH];
+        if (unwound) {
+            state = State::SEARCHING;
+            return;
+        }
+    }
 
-        int key = EncodePatterns(!east_loc ? 0 : (east_loc->ref ? east_loc->ref->GetPattern(WEST) : ANY_COLOR),
-            !south_loc ? 0 : (south_loc->ref ? south_loc->ref->GetPattern(NORTH) : ANY_COLOR),
-            !west_loc ? 0 : (west_loc->ref ? west_loc->ref->GetPattern(EAST) : ANY_COLOR),
-            !north_loc ? 0 : (north_loc->ref ? north_loc->ref->GetPattern(SOUTH) : ANY_COLOR));
+    // jump back to the deepest placement in conflict, the ones above are
+    // removed without trying their other candidates, as those would fail the
+    // same way, removal still counts them as explored like searching them would
+    while (backjumping && Backtrack()) {
+        int depth = static_cast<int>(stack.visited.size()) + 1;
+        if (!HasDepth(conflict.data(), depth)) {
+            continue;
+        }
 
-        auto it = neighbour_table.find(key);
-        if (it == neighbour_table.end())
-        {
-            return 0;
+        // the rest of conflict is left to the levels below, together with
+        // conflicts of other candidates of this location
+        conflict[depth / 64] &= ~(1ull << (depth % 64));
+        uint64_t* collected = &conflicts[depth * conflict_words];
+        for (int i = 0; i < conflict_words; ++i) {
+            collected[i] |= conflict[i];
+        }
+        if (!retry.forced) {
+            state = State::SEARCHING;
+            return;
         }
 
-        int feasible_count = 0;
-        PieceRef* repre = nullptr;
-        for (auto& piece : it->second) {
-            if (!locations_map[piece->GetId()]) {
-                auto it = forbidden_map.find(loc);
-                bool is_forbidden = false;
-                if (it != forbidden_map.end())
-                {
-                    if (it->second.find(piece) != it->second.end()) {
-                        is_forbidden = true;
-                    }
-                }
-                if (!is_forbidden) {
-                    repre = piece;
-                    feasible_count += 1;
-                }
-            }
+        // single candidate, the others are excluded by placements below
+        AddConflict(retry.loc);
+    }
 
-        }
+    // we should now unwrap beyond hint piece if there is any 
+    // this forces all pieces beyound it to be counted properly
+    if (stack.visited.size() > 1) {
+        stats.Update(static_cast<int>(stack.visited.size()) - 1);
+    }
 
-        if (feasible_count == 0) {
-            // impossible to place anything here, end asap
-            return 0;
-        }
+    state = State::FINISHED;
+}
 
-        if ((best_score == -1 || feasible_count < best_score)) {
-            best_score = feasible_count;
-            selected = repre;
-            selected_loc = loc;
-        }
+int Backtracker::CheckFeasible(Board::Loc*& feasible_location,
+    PieceRef*& feasible_piece, int& feasible_cursor)
+{
+    // until something is placed, consider also locations with no neighbours
+    Board::Loc* selected_loc = nullptr;
+    int best_score = frontier.Select(!stack.HasPlaced(), selected_loc);
+    feasible_location = selected_loc; // the one with no candidate on 0
+    if (best_score <= 0) {
+        // impossible to place anything here, end asap
+        return best_score;
     }
 
-    feasible_location = selected_loc;
-    feasible_piece = selected;
+    feasible_cursor = NextCandidate(selected_loc, -1, feasible_piece);
     return best_score;
 }
 
-void Backtracker::Place(Board::Loc* loc, PieceRef* ref)
+int Backtracker::NextCandidate(Board::Loc* loc, int cursor, PieceRef*& piece)
+{
+    int east = board.GetNeighbourPattern(loc, EAST, ANY_COLOR);
+    int south = board.GetNeighbourPattern(loc, SOUTH, ANY_COLOR);
+    int west = board.GetNeighbourPattern(loc, WEST, ANY_COLOR);
+    int north = board.GetNeighbourPattern(loc, NORTH, ANY_COLOR);
+
+    // candidates are tried from the last one towards the first one
+    if (engine == CandidateEngine::BITSET) {
+        bitsets.Match(east, south, west, north, matched.data());
+        cursor = bitsets.Prev(matched.data(), cursor);
+        piece = (cursor >= 0) ? bitsets.GetRef(cursor) : nullptr;
+        return cursor;
+    }
+
+    auto& locations_map = board.GetLocations();
+    auto bucket = candidates.Get(candidates.Encode(east, south, west, north));
+    if (cursor < 0) {
+        cursor = bucket.size();
+    }
+    for (--cursor; cursor >= 0; --cursor) {
+        if (!locations_map[bucket.first[cursor]->GetId()]) {
+            piece = bucket.first[cursor];
+            return cursor;
+        }
+    }
+    piece = nullptr;
+    return -1;
+}
+
+void Backtracker::Place(Board::Loc* loc, PieceRef* ref, int cursor)
 {
     LDEBUG("Placing %i at (%i, %i) [%i, %i, %i, %i]  dir=%i stack_size=%i\n",
         ref->GetId(), loc->x, loc->y, 
         ref->GetPattern(0), ref->GetPattern(1), ref->GetPattern(2), ref->GetPattern(3),
         ref->GetDir(), static_cast<int>(stack.visited.size()) + 1);
     board.PutPiece(loc, ref);
-    rot_checker.Place(ref->GetPattern(0),
-        ref->GetPattern(1),
-        ref->GetPattern(2),
-        ref->GetPattern(3));
+    if (engine == CandidateEngine::BITSET) {
+        bitsets.Place(ref);
+    }
+    rot_checker.Place(board, loc);
     switch (loc->type)
     {
     case Board::LocType::CORNER:
@@ -446,12 +364,14 @@ void Backtracker::Place(Board::Loc* loc, PieceRef* ref)
         break;
     }
 
-    unvisited.erase(loc);
+    frontier.Place(loc);
     int prev_score = stack.visited.top().score;
-    stack.visited.push(loc);
+    stack.visited.push(Stack::LevelInfo(loc, cursor));
+    depths[Index(loc)] = static_cast<int>(stack.visited.size());
+    piece_depths[ref->GetId()] = static_cast<int>(stack.visited.size());
     int neighbours = 0;
     for (int i = 0; i < 4; ++i) {
-        neighbours += (loc->neighbours[i] && loc->neighbours[i]->ref) ? 1 : 0;
+        neighbours += board.GetNeighbour(loc, i)->IsPlaced() ? 1 : 0;
     }
     int new_score = prev_score + neighbours;
     stack.visited.top().score = new_score;
@@ -463,6 +383,7 @@ void Backtracker::Place(Board::Loc* loc, PieceRef* ref)
         for (auto& callback : on_new_best) {
             callback->Call(board);
         }
+        reported = true;
     }        
 }
 
@@ -473,8 +394,8 @@ bool Backtracker::Backtrack()
     }
 
     Board::Loc* removing = stack.visited.top().loc;
+    retry = stack.visited.top();
     stack.visited.pop();
-    unvisited.insert(removing);
     int stack_pos = static_cast<int>(stack.visited.size());
 
     // update statistics
@@ -486,9 +407,6 @@ bool Backtracker::Backtrack()
         removing->ref->GetPattern(0), removing->ref->GetPattern(1), removing->ref->GetPattern(2), removing->ref->GetPattern(3),
         static_cast<int>(stack.visited.size()));
 
-    stack.visited.top().forbidden[removing].insert(removing->ref);
-
-    unplaced_pieces.insert(removing->ref);
     if (removing->type == Board::LocType::CORNER) {
         stats.UpdateUnplacedCorners(1);
     }
@@ -498,15 +416,44 @@ bool Backtracker::Backtrack()
     else {
         stats.UpdateUnplacedInner(1);
     }
-    rot_checker.Unplace(removing->ref->GetPattern(0),
-        removing->ref->GetPattern(1),
-        removing->ref->GetPattern(2),
-        removing->ref->GetPattern(3));
+    rot_checker.Unplace(board, removing);
+    if (engine == CandidateEngine::BITSET) {
+        bitsets.Unplace(removing->ref);
+    }
+    PieceRef* removed = removing->ref;
+    depths[Index(removing)] = 0;
+    piece_depths[removed->GetId()] = 0;
     board.RemovePiece(removing);
+    frontier.Unplace(removing, removed);
 
     return true;
 }
 
+void Backtracker::AddConflict(Board::Loc* loc)
+{
+    // depth 0 stands for anything not placed by search, it is never tested
+    for (int dir = 0; dir < 4; ++dir) {
+        AddDepth(conflict.data(), depths[Index(board.GetNeighbour(loc, dir))]);
+    }
+
+    for (auto& piece : candidates.Get(candidates.Encode(board.GetNeighbourPattern(loc, EAST, ANY_COLOR),
+        board.GetNeighbourPattern(loc, SOUTH, ANY_COLOR),
+        board.GetNeighbourPattern(loc, WEST, ANY_COLOR),
+        board.GetNeighbourPattern(loc, NORTH, ANY_COLOR)))) {
+        AddDepth(conflict.data(), piece_depths[piece->GetId()]);
+    }
+}
+
+void Backtracker::ConflictAll()
+{
+    std::fill(conflict.begin(), conflict.end(), ~0ull);
+}
+
+int Backtracker::Index(const Board::Loc* loc) const
+{
+    return static_cast<int>(loc - origin);
+}
+
 Stats& Backtracker::GetStats()
 {
     return stats;
@@ -521,3 +468,140 @@ void Backtracker::RegisterOnNewBest(CallbackOnSolve* callback)
 {
     on_new_best.push_back(callback);
 }
+
+void Backtracker::SetBackjumping(bool enabled)
+{
+    backjumping = enabled;
+}
+
+void Backtracker::RegisterOnSplit(CallbackOnSolve* callback, int depth)
+{
+    on_split = callback;
+    split_depth = depth;
+}
+
+void Backtracker::Save(Checkpoint& checkpoint)
+{
+    checkpoint.Put(CHECKPOINT_KIND);
+    checkpoint.Put(static_cast<int64_t>(state));
+    checkpoint.Put(highest_score);
+    checkpoint.Put(backjumping ? 1 : 0);
+
+    // levels above hints, from the bottom one
+    std::vector<Stack::LevelInfo> levels;
+    auto visited = stack.visited;
+    while (static_cast<int>(visited.size()) > stack.start_size) {
+        levels.push_back(visited.top());
+        visited.pop();
+    }
+    std::reverse(levels.begin(), levels.end());
+
+    checkpoint.Put(static_cast<int64_t>(levels.size()));
+    for (auto& level : levels) {
+        checkpoint.Put(level.loc->x);
+        checkpoint.Put(level.loc->y);
+        checkpoint.Put(level.loc->ref->GetId());
+        checkpoint.Put(level.loc->ref->GetDir());
+        checkpoint.Put(level.cursor);
+        checkpoint.Put(level.forced ? 1 : 0);
+    }
+    checkpoint.Put(retry.loc ? retry.loc->x : -1);
+    checkpoint.Put(retry.loc ? retry.loc->y : -1);
+    checkpoint.Put(retry.cursor);
+    for (auto word : conflict) {
+        checkpoint.Put(static_cast<int64_t>(word));
+    }
+    for (auto word : conflicts) {
+        checkpoint.Put(static_cast<int64_t>(word));
+    }
+
+    stats.Save(checkpoint);
+}
+
+bool Backtracker::Load(Checkpoint& checkpoint)
+{
+    if (checkpoint.GetInt() != CHECKPOINT_KIND) {
+        return false;
+    }
+    auto saved_state = static_cast<State>(checkpoint.GetInt());
+    int saved_highest_score = static_cast<int>(checkpoint.GetInt());
+    if ((checkpoint.GetInt() != 0) != backjumping) {
+        // conflict sets are kept only while backjumping
+        return false;
+    }
+
+    auto def = board.GetPuzzleDef();
+    auto& locations_map = board.GetLocations();
+    int count = static_cast<int>(checkpoint.GetInt());
+    for (int i = 0; i < count && checkpoint.IsValid(); ++i) {
+        int x = static_cast<int>(checkpoint.GetInt());
+        int y = static_cast<int>(checkpoint.GetInt());
+        int id = static_cast<int>(checkpoint.GetInt());
+        int dir = static_cast<int>(checkpoint.GetInt());
+        int cursor = static_cast<int>(checkpoint.GetInt());
+        bool forced = checkpoint.GetInt() != 0;
+        if (x < 0 || x >= def->GetHeight() || y < 0 || y >= def->GetWidth() ||
+            id < 1 || id > def->GetPieceCount() || dir < 0 || dir > 3 ||
+            board.GetLocation(x, y)->ref || locations_map[id]) {
+            return false;
+        }
+        Place(board.GetLocation(x, y), board.GetRef(id, dir), cursor);
+        stack.visited.top().forced = forced;
+    }
+
+    int x = static_cast<int>(checkpoint.GetInt());
+    int y = static_cast<int>(checkpoint.GetInt());
+    retry.cursor = static_cast<int>(checkpoint.GetInt());
+    retry.loc = (x >= 0 && x < def->GetHeight() && y >= 0 && y < def->GetWidth()) ? board.GetLocation(x, y) : nullptr;
+    for (auto& word : conflict) {
+        word = static_cast<uint64_t>(checkpoint.GetInt());
+    }
+    for (auto& word : conflicts) {
+        word = static_cast<uint64_t>(checkpoint.GetInt());
+    }
+
+    state = saved_state;
+    highest_score = saved_highest_score;
+    return stats.Load(checkpoint) && checkpoint.IsValid();
+}
+
+void Backtracker::GetPlacements(std::vector<HintDef>& placements) const
+{
+    placements.clear();
+    auto visited = stack.visited;
+    while (static_cast<int>(visited.size()) > stack.hints_size) {
+        auto loc = visited.top().loc;
+        placements.push_back(HintDef(loc->x, loc->y, loc->ref->GetId(), loc->ref->GetDir()));
+        visited.pop();
+    }
+    std::reverse(placements.begin(), placements.end());
+}
+
+bool Backtracker::Replay(const std::vector<HintDef>& placements)
+{
+    // levels of previously replayed subtree are removed first, what was
+    // explored in it is forgotten
+    stack.start_size = stack.hints_size;
+    while (Backtrack()) {
+    }
+    stats.Clear();
+    retry = Stack::LevelInfo(nullptr);
+    std::fill(conflict.begin(), conflict.end(), 0);
+    std::fill(conflicts.begin(), conflicts.end(), 0);
+    state = State::SEARCHING;
+
+    auto def = board.GetPuzzleDef();
+    auto& locations_map = board.GetLocations();
+    for (auto& placement : placements) {
+        if (placement.x < 0 || placement.x >= def->GetHeight() || placement.y < 0 || placement.y >= def->GetWidth() ||
+            placement.id < 1 || placement.id > def->GetPieceCount() || placement.dir < 0 || placement.dir > 3 ||
+            board.GetLocation(placement.x, placement.y)->ref || locations_map[placement.id]) {
+            return false;
+        }
+        // never backtracked into, so no candidate to continue with
+        Place(board.GetLocation(placement.x, placement.y), board.GetRef(placement.id, placement.dir), -1);
+        stack.visited.top().forced = true;
+    }
+    stack.start_size = static_cast<int>(stack.visited.size());
+    return true;
+}
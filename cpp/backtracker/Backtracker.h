@@ -1,45 +1,101 @@
 #pragma once
 
+#include <ctime>
 #include "Board.h"
+#include "Checkpoint.h"
+#include "CallbackOnSolve.h"
 #include "MpfWrapper.h"
 #include "Stack.h"
 #include "Stats.h"
 #include "ColorAxisCounts.h"
+#include "CandidateTable.h"
+#include "CandidateBitsets.h"
+#include "Frontier.h"
 
 namespace edge {
 
 namespace backtracker {
 
-class CallbackOnSolve {
-public:
-    virtual void Call(Board& board) = 0;
-
-};
-
 class Backtracker {
 public:
     Backtracker(Board& board,
         std::set<std::pair<int, int>>* pieces_map = nullptr,
         bool find_all = false,
-        const std::string& rotations_file = "");
+        const std::string& rotations_file = "",
+        CandidateEngine engine = CandidateEngine::TABLE);
 
     bool Step();
 
+    // runs steps until node_budget is spent, deadline (as returned by time,
+    // 0 for none) passes, solution or new best is found or the search ends,
+    // number of steps done is stored in nodes, returns false once finished
+    bool Run(long long node_budget, time_t deadline, long long& nodes);
+
     Stats& GetStats();
 
     void RegisterOnSolve(CallbackOnSolve* callback);
 
     void RegisterOnNewBest(CallbackOnSolve* callback);
 
+    // conflict-directed backjumping, failures skip back to the deepest
+    // placement responsible for them instead of the previous one, this keeps
+    // solutions and explored statistics exact, but skipped alternatives may
+    // reach higher scores than the ones searched, so new best positions are
+    // not reported reliably, off by default, to be called before Load and
+    // the first step
+    void SetBackjumping(bool enabled);
+
+    // positions reaching given depth below the start are handed to the
+    // callback and not searched any further, used to split the search
+    void RegisterOnSplit(CallbackOnSolve* callback, int depth);
+
+    // stores complete search state, to be called between steps
+    void Save(Checkpoint& checkpoint);
+
+    // continues search stored by Save, to be called right after construction
+    // with the same random seed and before registering callbacks, returns
+    // false if the checkpoint does not match this search
+    bool Load(Checkpoint& checkpoint);
+
+    // placements above hints in the order they were made
+    void GetPlacements(std::vector<HintDef>& placements) const;
+
+    // places pieces as ordinary levels (as returned by GetPlacements of the
+    // same search), search then stays within their subtree the same way it
+    // would be searched after reaching it, to be called right after
+    // construction (before registering callbacks) or once the previously
+    // replayed subtree is finished, which is then removed together with its
+    // statistics, returns false if the placements do not fit this search
+    bool Replay(const std::vector<HintDef>& placements);
+
 private:
+    static const int DEADLINE_CHECK_NODES = 0x1000; // how often Run checks the time
+
+    bool Search();
+
+    void Unwind();
+
     int CheckFeasible(Board::Loc*& feasible_location,
-        PieceRef*& feasible_piece);
+        PieceRef*& feasible_piece, int& feasible_cursor);
+
+    int NextCandidate(Board::Loc* loc, int cursor, PieceRef*& piece);
 
-    void Place(Board::Loc* loc, PieceRef* ref);
+    void Place(Board::Loc* loc, PieceRef* ref, int cursor);
+
+    // backtracks when remaining sides cannot match colours, hands subtree off
+    // at split depth
+    void CheckPlaced();
 
     bool Backtrack();
 
-    int EncodePatterns(int east, int south, int west, int north);
+    // adds depths of placements limiting candidates of loc (its placed
+    // neighbours and placed pieces fitting it) to conflict
+    void AddConflict(Board::Loc* loc);
+
+    // current failure may depend on any placement, backtrack chronologically
+    void ConflictAll();
+
+    int Index(const Board::Loc* loc) const;
 
 private:
     enum class State {
@@ -50,19 +106,35 @@ private:
 
     Board& board;
     State state;
+    CandidateEngine engine;
     Stack stack;
+    Stack::LevelInfo retry; // level just backtracked from, its location continues with next candidate
+    // conflict-directed backjumping, sets of depths (one bit per stack level)
+    // of placements responsible for failure, levels not in the set are
+    // skipped when backtracking, their other candidates would fail the same way,
+    // sets are kept only while enabled
+    bool backjumping;
+    int conflict_words;
+    std::vector< uint64_t > conflict; // current failure
+    std::vector< uint64_t > conflicts; // per depth, from failed candidates of its location
+    std::vector< int > depths; // location index -> depth of its piece, 0 if empty, hint or frame
+    std::vector< int > piece_depths; // piece id -> depth of its placement, 0 if unplaced or hint
+    const Board::Loc* origin; // first location of the board including frame
     Stats stats;
     ColorAxisCounts rot_checker;
 
-    std::set< PieceRef* > unplaced_pieces;
-    std::set<Board::Loc*> unvisited;
-    std::unordered_map<int, std::vector< PieceRef*>> neighbour_table;
+    CandidateTable candidates;
+    Frontier frontier; // locations still to be filled
+    CandidateBitsets bitsets;
+    std::vector< uint64_t > matched; // scratch bitset for bitsets engine
     int highest_score;
+    bool reported; // solution or new best found in current Run
     bool find_all;
-    bool connecting;
 
     std::vector< CallbackOnSolve* > on_solve;
     std::vector< CallbackOnSolve* > on_new_best;
+    CallbackOnSolve* on_split;
+    int split_depth;
 
 };
 
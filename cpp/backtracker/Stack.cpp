@@ -3,11 +3,15 @@
 using namespace edge::backtracker;
 
 bool Stack::IsEmpty() {
-    // empty == only root, plus possible hints
+    // empty == only root, plus possible hints and replayed levels
     return visited.size() == start_size;
 }
 
-Stack::Stack() : start_size(1)
+bool Stack::HasPlaced() {
+    return static_cast<int>(visited.size()) > hints_size;
+}
+
+Stack::Stack() : start_size(1), hints_size(1)
 {
     visited.push(LevelInfo(nullptr)); // root
 }
@@ -1,7 +1,5 @@
 #pragma once
 
-#include <unordered_map>
-#include <unordered_set>
 #include <stack>
 #include "Board.h"
 
@@ -14,21 +12,25 @@ public:
 
     struct LevelInfo {
         Board::Loc* loc;
-        std::unordered_map<Board::Loc*,
-            std::unordered_set< PieceRef* > > forbidden;
+        int cursor; // index of placed piece within candidates of loc
         int score;
+        bool forced; // loc had no other candidate, nothing to retry
 
-        LevelInfo(Board::Loc* loc) : loc(loc), score(0)
+        LevelInfo(Board::Loc* loc, int cursor = -1) : loc(loc), cursor(cursor), score(0), forced(false)
         {
         }
     };
 
     bool IsEmpty();
 
+    // something placed above root and hints (including replayed levels)
+    bool HasPlaced();
+
     Stack();
 
     std::stack<LevelInfo> visited;
-    int start_size;
+    int start_size; // search does not backtrack below
+    int hints_size;
 
 private:
 
@@ -36,4 +38,4 @@ private:
 
 }
 
-}
\ No newline at end of file
+}
@@ -3,6 +3,9 @@
 #include "PuzzleDef.h"
 #include "Board.h"
 #include "Backtracker.h"
+#include "ParallelSearch.h"
+#include "Args.h"
+#include "Checkpoint.h"
 #include <time.h>
 #include <Windows.h>
 
@@ -64,10 +67,34 @@ private:
     int counter;
 };
 
+static const long long RUN_NODES = 0x10000; // most steps done between checks of time
+
 int main(int argc, char* argv[])
 {
+    edge::Args args(argc, argv);
+
+    // --checkpoint=FILE stores search state every --checkpoint-interval seconds
+    // (default 60), with --resume the search stored in it is continued
+    std::string checkpoint_file = args.Get("checkpoint");
+    int checkpoint_interval = args.GetInt("checkpoint-interval", 60);
+    if (args.Has("resume") && checkpoint_file.empty()) {
+        printf("--resume needs --checkpoint\n");
+        return 1;
+    }
+    if (!checkpoint_file.empty() && args.GetInt("threads", 1) > 1) {
+        printf("--checkpoint cannot be used with --threads\n");
+        return 1;
+    }
+    edge::backtracker::Checkpoint checkpoint(checkpoint_file);
+    bool resume = args.Has("resume") && !checkpoint_file.empty();
+    if (resume && !checkpoint.Load()) {
+        printf("Unable to load checkpoint %s\n", checkpoint_file.c_str());
+        return 1;
+    }
+
+    // resumed search must see the same random sequence, seed is stored first
     std::random_device rd;
-    unsigned int seed = rd();
+    unsigned int seed = resume ? static_cast<unsigned int>(checkpoint.GetInt()) : rd();
     printf("seed: %u\n", seed);
     srand(seed);
     // generate prefix for saves
@@ -83,23 +110,36 @@ int main(int argc, char* argv[])
     }
     printf("save_prefix: %s\n", prefix.c_str());
 
-    // fixed arguments for now
-    if (argc <= 1) {
+    // positional arguments: definition, [hints], [rotations]
+    auto& positional = args.GetPositional();
+    if (positional.empty()) {
         printf("Missing puzzle definition argument\n");
         return 1;
     }
 
-    std::string def_file = argv[1];
+    std::string def_file = positional[0];
     std::string hints_file = "";
-    if (argc > 2) {
-        hints_file = argv[2];
+    if (positional.size() > 1) {
+        hints_file = positional[1];
     }
 
     std::string rotations_file = "";
-    if (argc > 3) {
-        rotations_file = argv[3];
+    if (positional.size() > 2) {
+        rotations_file = positional[2];
     }
 
+    // --engine=bitset selects bitset candidate intersection instead of table lookup
+    auto engine = (args.Get("engine") == "bitset") ?
+        edge::backtracker::CandidateEngine::BITSET : edge::backtracker::CandidateEngine::TABLE;
+
+    // --backjump skips back to the placement causing the failure, solutions and
+    // statistics stay exact, new best positions may be missed
+    bool backjump = args.Has("backjump");
+
+    // --threads=N searches subtrees below --split-depth=K placements on N threads
+    int threads = args.GetInt("threads", 1);
+    int split_depth = args.GetInt("split-depth", 4);
+
     edge::PuzzleDef def = edge::PuzzleDef::Load(def_file, hints_file);
     edge::Board board(&def);
 
@@ -116,19 +156,72 @@ int main(int argc, char* argv[])
 
     Solved solved_callback(prefix);
     NewBest newbest_callback(prefix);
-    edge::backtracker::Backtracker backtracker(board, pMap, true, rotations_file);
+
+    if (threads > 1) {
+        edge::backtracker::ParallelSearch<edge::backtracker::Backtracker> search(
+            board, true, rotations_file, engine, threads, split_depth);
+        search.RegisterOnSolve(&solved_callback);
+        search.RegisterOnNewBest(&newbest_callback);
+        search.SetSolverSetup([backjump](edge::backtracker::Backtracker& solver) {
+            solver.SetBackjumping(backjump);
+        });
+
+        int start_absolute = (int)time(0);
+        search.Start();
+        long long last_steps = 0;
+        while (search.IsRunning()) {
+            Sleep(1000);
+
+            std::string explAbsLast, explAbs, explMax, explRatio;
+            auto& stats = search.GetStats();
+            stats.GetExploredAbsLast().PrintExp(explAbsLast);
+            stats.GetExploredAbs().PrintExp(explAbs);
+            stats.GetExploredRatio().PrintExp(explRatio);
+            stats.GetExploredMax().PrintExp(explMax);
+
+            long long steps = search.GetSteps();
+            printf("max_score: %i, threads: %i, iters: %lli, "
+                "explAbsLast: %s, explAbs: %s, explRatio: %s, explMax: %s\n",
+                newbest_callback.max_score, threads, steps - last_steps, explAbsLast.c_str(), explAbs.c_str(), explRatio.c_str(), explMax.c_str());
+            last_steps = steps;
+        }
+        search.Wait();
+
+        printf("finished in %i sec\n", (int)time(0) - start_absolute);
+        std::string explAbs, explMax, explRatio;
+        auto& stats = search.GetStats();
+        stats.GetExploredAbs().PrintExp(explAbs);
+        stats.GetExploredRatio().PrintExp(explRatio);
+        stats.GetExploredMax().PrintExp(explMax);
+
+        printf("max_score: %i, iters: %lli, explAbs: %s, explRatio: %s, explMax: %s\n",
+            newbest_callback.max_score, search.GetSteps(), explAbs.c_str(), explRatio.c_str(), explMax.c_str());
+
+        return 0;
+    }
+
+    edge::backtracker::Backtracker backtracker(board, pMap, true, rotations_file, engine);
+    backtracker.SetBackjumping(backjump);
+    if (resume && !backtracker.Load(checkpoint)) {
+        printf("Checkpoint %s does not match this search\n", checkpoint_file.c_str());
+        return 1;
+    }
     backtracker.RegisterOnSolve(&solved_callback);
     backtracker.RegisterOnNewBest(&newbest_callback);
 
     int i = 0;
     int start = (int)time(0);
     int start_absolute = start;
+    int last_checkpoint = start;
     int score = 0;
     int max_score = 0;
     printf("score: %i\n", score);
-    while (backtracker.Step()) {
-
-        i += 1;
+    // steps are run in batches, time is checked only in between
+    bool keep_going = true;
+    while (keep_going) {
+        long long nodes = 0;
+        keep_going = backtracker.Run(RUN_NODES, start + 1, nodes);
+        i += static_cast<int>(nodes);
         //if (i % 5 == 0) {
         //    Sleep(1);
         //}
@@ -150,6 +243,21 @@ int main(int argc, char* argv[])
             i = 0;
             start = now;
         }
+
+        if (!checkpoint_file.empty() && now - last_checkpoint >= checkpoint_interval) {
+            checkpoint.Clear();
+            checkpoint.Put(seed);
+            backtracker.Save(checkpoint);
+            checkpoint.Save();
+            last_checkpoint = now;
+        }
+    }
+
+    if (!checkpoint_file.empty()) {
+        checkpoint.Clear();
+        checkpoint.Put(seed);
+        backtracker.Save(checkpoint);
+        checkpoint.Save();
     }
 
     printf("finished in %i sec\n", (int)time(0) - start_absolute);
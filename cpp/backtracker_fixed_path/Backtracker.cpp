@@ -4,13 +4,16 @@
 
 using namespace edge::backtracker;
 
-const int ANY_COLOR = 0xFF;
+static const int64_t CHECKPOINT_KIND = 0x46495845; // "FIXE"
 
 Backtracker::Backtracker(Board& board, std::set<std::pair<int, int>>* pieces_map, bool find_all,
-    const std::string& rotations_file)
-    : board(board), state(State::SEARCHING),
+    const std::string& rotations_file, CandidateEngine engine)
+    : board(board), state(State::SEARCHING), engine(engine),
     find_all(find_all), connecting(true),
-    highest_score(0)
+    highest_score(0), reported(false), on_split(nullptr), split_depth(0),
+    nogoods(nullptr), solved_or_split(0), nogood_placements(0), nogood_probes(0), nogood_hits(0), nogood_stores(0),
+    completions(nullptr), completion_level(0), completion_probes(0), completion_hits(0), completion_stores(0),
+    completion_nodes(0)
 {
     //for (int x = 0; x < board.GetPuzzleDef()->GetHeight(); ++x) {
     //    for (int y = 0; y < board.GetPuzzleDef()->GetWidth(); ++y) {
@@ -25,7 +28,8 @@ Backtracker::Backtracker(Board& board, std::set<std::pair<int, int>>* pieces_map
     }
 
     pieces_count = board.GetPuzzleDef()->GetPieceCount();
-    stack.visited.top().forbidden.resize(pieces_count);
+    stack.Init(pieces_count, pieces_count);
+    scores.reserve(pieces_count);
 
     std::map<int, int> rotations;
     if (!rotations_file.empty()) {
@@ -56,22 +60,7 @@ Backtracker::Backtracker(Board& board, std::set<std::pair<int, int>>* pieces_map
         }       
     }
 
-    for (auto& piece : board.GetPuzzleDef()->GetAll()) {
-        if (!rotations.empty())
-        {
-            unplaced_pieces.insert(board.GetRef(piece.second.id,rotations[piece.second.id]));
-        }
-        else {
-            for (int dir = 0; dir < 4; ++dir) {
-                unplaced_pieces.insert(board.GetRef(piece.second.id,dir));
-            }
-        }
-    }
-
     stats.Init(board);
-#ifdef ROTATION_CHECK
-    rot_checker.Init(board.GetPuzzleDef());
-#endif
 
     // hints
     if (true/*rotations_file.empty()*/) // for now, this is how we ignore hints argument if rotations are being checked
@@ -79,213 +68,51 @@ Backtracker::Backtracker(Board& board, std::set<std::pair<int, int>>* pieces_map
         for (auto& hint : board.GetPuzzleDef()->GetHints()) {
             int dir = (hint.dir != -1) ? hint.dir : 0;
             board.PutPiece(hint.id, hint.x, hint.y, dir);
-#ifdef ROTATION_CHECK
-            rot_checker.Place(board.GetLocation(hint.x, hint.y)->ref->GetPattern(0),
-                board.GetLocation(hint.x, hint.y)->ref->GetPattern(1),
-                board.GetLocation(hint.x, hint.y)->ref->GetPattern(2),
-                board.GetLocation(hint.x, hint.y)->ref->GetPattern(3));
-#endif
-
-            std::vector< PieceRef* > to_erase;
-
-            to_erase.clear();
-            for (auto& ref : unplaced_pieces) {
-                if (ref->GetId() == hint.id) {
-                    to_erase.push_back(ref);
-                }
-            }
-            for (auto& ref : to_erase) {
-                unplaced_pieces.erase(ref);
-            }
 
             auto loc = board.GetLocation(hint.x, hint.y);
-            stack.visited.push(Stack::LevelInfo(pieces_count));
+            stack.Push();
             stack.start_size++;
 
             path.push_back(loc);
-            connected_locations.push_back(std::vector<Board::Loc*>());
 
             int prev_score = scores.empty() ? 0 : scores.back();
             int neighbours = 0;
             for (int i = 0; i < 4; ++i) {
-                neighbours += (loc->neighbours[i] && loc->neighbours[i]->ref) ? 1 : 0;
+                neighbours += board.GetNeighbour(loc, i)->IsPlaced() ? 1 : 0;
             }
             scores.push_back(prev_score + neighbours);
         }
     }
 
-    highest_score = static_cast<int>(stack.visited.size());
+#ifdef ROTATION_CHECK
+    rot_checker.Init(board);
+#endif
+
+    highest_score = static_cast<int>(stack.Size());
     board.AdjustDirBorder();
 
     // create fast access structure for finding all pieces matching
     // given list of patterns
-    // TBD - following need refactor + fix to work with specific pieces rotation provided
-    for (auto& piece : board.GetPuzzleDef()->GetInner()) {
+    std::vector<PieceRef*> allowed;
+    candidates.Init(board.GetPuzzleDef());
+    for (auto& piece : board.GetPuzzleDef()->GetAll()) {
         for (int dir = 0; dir < 4; ++dir) {
-            if (rotations.empty() || rotations[piece.id] == dir)
+            if (rotations.empty() || rotations[piece.first] == dir)
             {
-                auto ref = board.GetRef(piece.id, dir);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ANY_COLOR, ANY_COLOR)].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ANY_COLOR, ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ANY_COLOR, ANY_COLOR)].push_back(ref);
+                candidates.Add(board.GetRef(piece.first, dir));
+                allowed.push_back(board.GetRef(piece.first, dir));
             }
         }
     }
+    candidates.Build();
+    holes.Init(board, candidates, allowed);
 
-
-    for (auto& piece : board.GetPuzzleDef()->GetCorners()) 
-    {
-        // corners are of form something, something, 0, 0
-        {
-            if (rotations.empty() || rotations[piece.id] == 0)
-            {
-                auto ref = board.GetRef(piece.id, 0); // something, something, 0, 0
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-            }
-        }
-
-        {
-            if (rotations.empty() || rotations[piece.id] == 1)
-            {
-                auto ref = board.GetRef(piece.id, 1); // 0, something, something, 0
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-            }
-        }
-
-        {
-            if (rotations.empty() || rotations[piece.id] == 2)
-            {
-                auto ref = board.GetRef(piece.id, 2); // 0, 0, something, something
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ANY_COLOR)].push_back(ref);
-            }
-        }
-
-        {
-            if (rotations.empty() || rotations[piece.id] == 3)
-            {
-                auto ref = board.GetRef(piece.id, 3); // something, 0, 0, something
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-            }
-        }
-
-    }
-
-    for (auto& piece : board.GetPuzzleDef()->GetEdges())
-    {
-        // edges are of form something, something, something, 0
-        {
-            if (rotations.empty() || rotations[piece.id] == 0)
-            {
-                auto ref = board.GetRef(piece.id, 0); // something, something, something, 0
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-            }
-        }
-
-        {
-            if (rotations.empty() || rotations[piece.id] == 1)
-            {
-                auto ref = board.GetRef(piece.id, 1); // 0, something, something, something 
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ANY_COLOR, ANY_COLOR)].push_back(ref);
-            }
-        }
-
-        {
-            if (rotations.empty() || rotations[piece.id] == 2)
-            {
-                auto ref = board.GetRef(piece.id, 2); // something, 0, something, something 
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ANY_COLOR, ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ANY_COLOR, ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ANY_COLOR, ANY_COLOR)].push_back(ref);
-            }
-        }
-
-        {
-            if (rotations.empty() || rotations[piece.id] == 3)
-            {
-                auto ref = board.GetRef(piece.id, 3); // something, something, 0, something 
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ref->GetPattern(WEST), ref->GetPattern(NORTH))].push_back(ref);
-                neighbour_table[EncodePatterns(ANY_COLOR, ref->GetPattern(SOUTH), ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-                neighbour_table[EncodePatterns(ref->GetPattern(EAST), ANY_COLOR, ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-
-                neighbour_table[EncodePatterns(ANY_COLOR, ANY_COLOR, ref->GetPattern(WEST), ANY_COLOR)].push_back(ref);
-            }
+    if (engine == CandidateEngine::BITSET) {
+        bitsets.Init(board, rotations);
+        for (auto& hint : board.GetPuzzleDef()->GetHints()) {
+            bitsets.Place(board.GetLocation(hint.x, hint.y)->ref);
         }
-    }
-
-    // shuffle the neighbour table to give this particular run bit of randomness
-    for (auto& item : neighbour_table) {
-        std::random_shuffle(item.second.begin(), item.second.end());
+        matched.resize(bitsets.GetWords());
     }
 
     // set path
@@ -855,247 +682,289 @@ Backtracker::Backtracker(Board& board, std::set<std::pair<int, int>>* pieces_map
 
 }
 
-int Backtracker::EncodePatterns(int east, int south, int west, int north)
-{
-    int encoded = east;
-
-    encoded *= ANY_COLOR + 1;
-    encoded += south;
-
-    encoded *= ANY_COLOR + 1;
-    encoded += west;
-
-    encoded *= ANY_COLOR + 1;
-    encoded += north;
-
-    return encoded;
-}
-
 bool Backtracker::Step()
 {
     switch (state)
     {
     case State::SEARCHING:
-    {
-        if (stack.visited.size() - 1 == pieces_count) {
-            for (auto& callback : on_solve) {
-                callback->Call(board);
-            }
+        return Search();
+    case State::BACKTRACKING:
+        Unwind();
+        return true;
+    default:
+        return false;
+    }
+}
 
-            if (!find_all) {
-                // everything already placed, solved...
-                state = State::FINISHED;
-                return false;
-            }
+bool Backtracker::Run(long long node_budget, time_t deadline, long long& nodes)
+{
+    nodes = 0;
+    reported = false;
+    while (nodes < node_budget) {
+        if (state == State::SEARCHING) {
+            Search();
+        }
+        else if (state == State::BACKTRACKING) {
+            Unwind();
+        }
+        else {
+            break;
+        }
+        ++nodes;
 
-            state = State::BACKTRACKING;
-            return true;
+        // let the caller react to solution or new best
+        if (reported) {
+            break;
         }
 
-        // this branch will be called at most once per number of pieces, not time critical
-        if (connected_locations.size() < stack.visited.size()) {
-            // we have not created a map of connected locations for this location, do this now
-            std::set<Board::Loc*> connected; // set to avoid duplicates at first
+        if (deadline && nodes % DEADLINE_CHECK_NODES == 0 && time(0) >= deadline) {
+            break;
+        }
+    }
 
-            auto& locations_map = board.GetLocations();
-            for (int x = 0; x < board.GetPuzzleDef()->GetHeight(); ++x) {
-                for (int y = 0; y < board.GetPuzzleDef()->GetWidth(); ++y) {
-                    auto loc = board.GetLocation(x, y);
-                    if (!loc->ref) { // nothing here yet
-
-                        auto& east_loc = loc->neighbours[EAST];
-                        auto& south_loc = loc->neighbours[SOUTH];
-                        auto& west_loc = loc->neighbours[WEST];
-                        auto& north_loc = loc->neighbours[NORTH];
-
-                        int neighbour_count = 0;
-                        neighbour_count += (east_loc && east_loc->ref) ? 1 : 0;
-                        neighbour_count += (south_loc && south_loc->ref) ? 1 : 0;
-                        neighbour_count += (west_loc && west_loc->ref) ? 1 : 0;
-                        neighbour_count += (north_loc && north_loc->ref) ? 1 : 0;
-
-                        if (neighbour_count != 0)
-                        {
-                            connected.insert(loc);
-                        }
-                    }
-                }
-            }
+    if (nogoods) {
+        nogoods->Count(nogood_probes, nogood_hits, nogood_stores);
+        nogood_probes = 0;
+        nogood_hits = 0;
+        nogood_stores = 0;
+    }
+    if (completions) {
+        completions->Count(completion_probes, completion_hits, completion_stores, completion_nodes);
+        completion_probes = 0;
+        completion_hits = 0;
+        completion_stores = 0;
+        completion_nodes = 0;
+    }
 
-            // convert set to vector for faster iteration later
-            std::vector<Board::Loc*> connected_vec;
-            for (auto& loc : connected) {
-                connected_vec.push_back(loc);
-            }
-            connected_locations.push_back(connected_vec);
+    return state != State::FINISHED;
+}
+
+bool Backtracker::Search()
+{
+    if (stack.Size() - 1 == pieces_count) {
+        for (auto& callback : on_solve) {
+            callback->Call(board);
         }
+        reported = true;
+        ++solved_or_split;
 
-        // check whether there are some connecting spots which cannot be filled by anything...
-        auto& locations_map = board.GetLocations();
-        for(auto& loc : connected_locations[stack.visited.size() - 1])
-        {
-            auto& east_loc = loc->neighbours[EAST];
-            auto& south_loc = loc->neighbours[SOUTH];
-            auto& west_loc = loc->neighbours[WEST];
-            auto& north_loc = loc->neighbours[NORTH];
-
-            int key = EncodePatterns(!east_loc ? 0 : (east_loc->ref ? east_loc->ref->GetPattern(WEST) : ANY_COLOR),
-                !south_loc ? 0 : (south_loc->ref ? south_loc->ref->GetPattern(NORTH) : ANY_COLOR),
-                !west_loc ? 0 : (west_loc->ref ? west_loc->ref->GetPattern(EAST) : ANY_COLOR),
-                !north_loc ? 0 : (north_loc->ref ? north_loc->ref->GetPattern(SOUTH) : ANY_COLOR));
-
-            auto it = neighbour_table.find(key);
-            if (it == neighbour_table.end())
-            { // no piece found that can match this combination of pattern
-                state = State::BACKTRACKING;
-                return true;
-            }
+        if (!find_all) {
+            // everything already placed, solved...
+            state = State::FINISHED;
+            return false;
+        }
 
-            bool has_feasible = false;
-            for (auto& piece : it->second) {
-                if (!locations_map[piece->GetId()]) { // not yet placed
-                    has_feasible = true;
-                    break;
-                }
-            }
+        state = State::BACKTRACKING;
+        return true;
+    }
 
-            if (!has_feasible) {
-                // there is a position where nothing can be placed, backtrack
-                state = State::BACKTRACKING;
-                return true;
-            }
-        }
+    // check whether there are some connecting spots which cannot be filled by anything...
+    if (holes.IsBlocked()) {
+        // there is a position where nothing can be placed, backtrack
+        state = State::BACKTRACKING;
+        return true;
+    }
 
-        // this branch will be called at most once per number of pieces, not time critical
-        if (path.size() < stack.visited.size()) {
-            // path not defined, we create our own as we go
+    // this branch will be called at most once per number of pieces, not time critical
+    if (path.size() < stack.Size()) {
+        // path not defined, we create our own as we go
 
-            // we check all connected pieces, and find such that it contains least feasible possibilities
-            auto& locations_map = board.GetLocations();
-            int min_feasible_count = -1;
-            std::vector<Board::Loc*> min_locs;
-            for (int x = 0; x < board.GetPuzzleDef()->GetHeight(); ++x) {
-                for (int y = 0; y < board.GetPuzzleDef()->GetWidth(); ++y) {
-                    auto loc = board.GetLocation(x, y);
-                    if (!loc->ref) { // nothing here yet
+        // we check all connected pieces, and find such that it contains least feasible possibilities
+        auto& locations_map = board.GetLocations();
+        int min_feasible_count = -1;
+        std::vector<Board::Loc*> min_locs;
+        for (int x = 0; x < board.GetPuzzleDef()->GetHeight(); ++x) {
+            for (int y = 0; y < board.GetPuzzleDef()->GetWidth(); ++y) {
+                auto loc = board.GetLocation(x, y);
+                if (!loc->ref) { // nothing here yet
 
-                        auto& east_loc = loc->neighbours[EAST];
-                        auto& south_loc = loc->neighbours[SOUTH];
-                        auto& west_loc = loc->neighbours[WEST];
-                        auto& north_loc = loc->neighbours[NORTH];
+                    auto east_loc = board.GetNeighbour(loc, EAST);
+                    auto south_loc = board.GetNeighbour(loc, SOUTH);
+                    auto west_loc = board.GetNeighbour(loc, WEST);
+                    auto north_loc = board.GetNeighbour(loc, NORTH);
 
 #if 1
-                        int neighbour_count = 0;
-                        neighbour_count += (east_loc && east_loc->ref) ? 1 : 0;
-                        neighbour_count += (south_loc && south_loc->ref) ? 1 : 0;
-                        neighbour_count += (west_loc && west_loc->ref) ? 1 : 0;
-                        neighbour_count += (north_loc && north_loc->ref) ? 1 : 0;
-
-                        if (neighbour_count == 0 && path.size() > 0) {
-                            // only add locations that are connected
-                            continue;
-                        }
+                    int neighbour_count = 0;
+                    neighbour_count += east_loc->IsPlaced() ? 1 : 0;
+                    neighbour_count += south_loc->IsPlaced() ? 1 : 0;
+                    neighbour_count += west_loc->IsPlaced() ? 1 : 0;
+                    neighbour_count += north_loc->IsPlaced() ? 1 : 0;
+
+                    if (neighbour_count == 0 && path.size() > 0) {
+                        // only add locations that are connected
+                        continue;
+                    }
 #endif
 
-                        int key = EncodePatterns(!east_loc ? 0 : (east_loc->ref ? east_loc->ref->GetPattern(WEST) : ANY_COLOR),
-                            !south_loc ? 0 : (south_loc->ref ? south_loc->ref->GetPattern(NORTH) : ANY_COLOR),
-                            !west_loc ? 0 : (west_loc->ref ? west_loc->ref->GetPattern(EAST) : ANY_COLOR),
-                            !north_loc ? 0 : (north_loc->ref ? north_loc->ref->GetPattern(SOUTH) : ANY_COLOR));
+                    int key = candidates.Encode(board.GetNeighbourPattern(loc, EAST, ANY_COLOR),
+                        board.GetNeighbourPattern(loc, SOUTH, ANY_COLOR),
+                        board.GetNeighbourPattern(loc, WEST, ANY_COLOR),
+                        board.GetNeighbourPattern(loc, NORTH, ANY_COLOR));
 
-                        auto it = neighbour_table.find(key);
-                        if (it == neighbour_table.end())
-                        { // no piece found that can match this combination of pattern
-                            state = State::BACKTRACKING;
-                            return true;
-                        }
+                    auto bucket = candidates.Get(key);
+                    if (bucket.size() == 0)
+                    { // no piece found that can match this combination of pattern
+                        state = State::BACKTRACKING;
+                        return true;
+                    }
 
-                        int feasible_count = 0;
-                        for (auto& piece : it->second) {
-                            if (!locations_map[piece->GetId()]) { // not yet placed
-                                feasible_count += 1;
-                            }
+                    int feasible_count = 0;
+                    for (auto& piece : bucket) {
+                        if (!locations_map[piece->GetId()]) { // not yet placed
+                            feasible_count += 1;
                         }
+                    }
 
-                        if (min_feasible_count == -1 || feasible_count < min_feasible_count) {
-                            min_feasible_count = feasible_count;
-                            min_locs.clear();
-                            min_locs.push_back(loc);
-                        }
-                        else if (feasible_count == min_feasible_count)
-                        {
-                            min_locs.push_back(loc);
-                        }
+                    if (min_feasible_count == -1 || feasible_count < min_feasible_count) {
+                        min_feasible_count = feasible_count;
+                        min_locs.clear();
+                        min_locs.push_back(loc);
+                    }
+                    else if (feasible_count == min_feasible_count)
+                    {
+                        min_locs.push_back(loc);
                     }
                 }
             }
+        }
 
-            int idx = rand() % min_locs.size();
-            path.push_back(min_locs[idx]);
+        int idx = rand() % min_locs.size();
+        path.push_back(min_locs[idx]);
 
-            // debug
-            printf("path updated: ");
-            for (auto& loc : path) {
-                printf(",(%i, %i)", loc->x, loc->y);
-            }
-            printf("\n");
+        // debug
+        printf("path updated: ");
+        for (auto& loc : path) {
+            printf(",(%i, %i)", loc->x, loc->y);
         }
+        printf("\n");
+    }
 
-        PieceRef* selected_piece = nullptr;
-        Board::Loc* selected_loc = nullptr;
+    PieceRef* selected_piece = nullptr;
+    Board::Loc* selected_loc = nullptr;
 
-        int best_score = CheckFeasible(selected_loc, selected_piece);
-        if (best_score <= 0) {
-            // impossible to place anything here... backtrack
-            state = State::BACKTRACKING;
+    int best_score = CheckFeasible(selected_loc, selected_piece);
+    if (best_score <= 0) {
+        // impossible to place anything here... backtrack
+        state = State::BACKTRACKING;
 
-            return true;
-        }
+        return true;
+    }
 
-        Place(selected_loc, selected_piece);
-        unplaced_pieces.erase(selected_piece);
+    Place(selected_loc, selected_piece);
 
-        // if inconsistent rotations, backtrack...
+    // if remaining sides cannot match colours of the board, backtrack...
 #ifdef ROTATION_CHECK
-        if (!rot_checker.CanBeFinished(selected_piece->GetPattern(0)) ||
-            !rot_checker.CanBeFinished(selected_piece->GetPattern(1)) ||
-            !rot_checker.CanBeFinished(selected_piece->GetPattern(2)) ||
-            !rot_checker.CanBeFinished(selected_piece->GetPattern(3)) ) {
-            LDEBUG("Inconsistent rotation, initating backtrack...\n");
-            state = State::BACKTRACKING;
-        }
+    if (!rot_checker.CanBeFinished()) {
+        LDEBUG("Inconsistent rotation, initating backtrack...\n");
+        state = State::BACKTRACKING;
+    }
 #endif
 
-        return true;
+    if (state == State::SEARCHING && nogoods) {
+        int placed = static_cast<int>(stack.Size()) - 1;
+        ++nogood_placements;
+        nogood_entered[placed] = -1;
+        if (nogood_levels[placed]) {
+            ++nogood_probes;
+            if (nogoods->Contains(board.GetRemainingHash() ^ frontier_keys[placed])) {
+                // the same position was already searched in vain
+                ++nogood_hits;
+                state = State::BACKTRACKING;
+            }
+        }
+        if (state == State::SEARCHING) {
+            nogood_entered[placed] = solved_or_split;
+            nogood_start[placed] = nogood_placements;
+        }
     }
-    break;
-    case State::BACKTRACKING:
-    {
-        if (Backtrack()) {
-            state = State::SEARCHING;
+
+    if (state == State::SEARCHING && completions &&
+        static_cast<int>(stack.Size()) - 1 == completion_level) {
+        int placed = completion_level;
+        uint64_t key = board.GetRemainingHash() ^ frontier_keys[placed];
+        int reached = 0;
+        ++completion_probes;
+        if (completions->Find(key, reached)) {
+            ++completion_hits;
         }
         else {
-            // we should now unwrap beyond hint piece if there is any 
-            // this forces all pieces beyound it to be counted properly
-            if (stack.visited.size() > 1) {
-                stats.Update(static_cast<int>(stack.visited.size()) - 1);
-            }
+            reached = Complete(placed);
+            completions->Add(key, reached);
+            ++completion_stores;
+        }
 
-            state = State::FINISHED;
+        // rest of the subtree only needs to be walked for solution or new best
+        if (reached < static_cast<int>(path.size()) - placed && path_scores[placed - 1 + reached] <= highest_score) {
+            state = State::BACKTRACKING;
         }
     }
-    break;
-    case State::FINISHED:
-    {
-        return false;
-    }
-    break;
-    default:
-        break;
+
+    if (state == State::SEARCHING && on_split &&
+        static_cast<int>(stack.Size()) - stack.start_size == split_depth) {
+        // this subtree is searched elsewhere
+        stats.HandOff();
+        ++solved_or_split;
+        on_split->Call(board);
+        state = State::BACKTRACKING;
     }
 
     return true;
 }
 
+void Backtracker::Unwind()
+{
+    if (Backtrack()) {
+        state = State::SEARCHING;
+    }
+    else {
+        // we should now unwrap beyond hint piece if there is any 
+        // this forces all pieces beyound it to be counted properly
+        if (stack.Size() > 1) {
+            stats.Update(static_cast<int>(stack.Size()) - 1);
+        }
+
+        state = State::FINISHED;
+    }
+}
+
+uint64_t Backtracker::GetEdgeKey(const Board::Loc* loc, int dir) const
+{
+    uint64_t side = static_cast<uint64_t>((loc->x * board.GetPuzzleDef()->GetWidth() + loc->y) * 4 + dir);
+    return MixHash((side << 8) | static_cast<uint64_t>(loc->ref->GetPattern(dir)));
+}
+
+int Backtracker::Complete(int index)
+{
+    if (index == static_cast<int>(path.size())) {
+        return 0;
+    }
+    ++completion_nodes;
+
+    auto& locations_map = board.GetLocations();
+    auto loc = path[index];
+    int key = candidates.Encode(board.GetNeighbourPattern(loc, EAST, ANY_COLOR),
+        board.GetNeighbourPattern(loc, SOUTH, ANY_COLOR),
+        board.GetNeighbourPattern(loc, WEST, ANY_COLOR),
+        board.GetNeighbourPattern(loc, NORTH, ANY_COLOR));
+    int most = 0;
+    for (auto& piece : candidates.Get(key)) {
+        if (locations_map[piece->GetId()]) {
+            continue;
+        }
+        board.PutPiece(loc, piece);
+        int reached = 1 + Complete(index + 1);
+        board.RemovePiece(loc);
+        if (reached > most) {
+            most = reached;
+            if (index + most == static_cast<int>(path.size())) {
+                // completed, nothing more to find
+                break;
+            }
+        }
+    }
+    return most;
+}
+
 int Backtracker::CheckFeasible(Board::Loc*& feasible_location,
     PieceRef*& feasible_piece)
 {
@@ -1103,35 +972,36 @@ int Backtracker::CheckFeasible(Board::Loc*& feasible_location,
 
     PieceRef* selected = nullptr;
     Board::Loc* selected_loc = nullptr;
-    auto& forbidden_map = stack.visited.top().forbidden;
     auto& locations_map = board.GetLocations();
 
     // TBD we should visit unvisited in random order too ...
-    auto& loc = path[stack.visited.size() - 1];
-
-    auto& east_loc = loc->neighbours[EAST];
-    auto& south_loc = loc->neighbours[SOUTH];
-    auto& west_loc = loc->neighbours[WEST];
-    auto& north_loc = loc->neighbours[NORTH];
+    auto& loc = path[stack.Size() - 1];
 
-    int key = EncodePatterns(!east_loc ? 0 : (east_loc->ref ? east_loc->ref->GetPattern(WEST) : ANY_COLOR),
-        !south_loc ? 0 : (south_loc->ref ? south_loc->ref->GetPattern(NORTH) : ANY_COLOR),
-        !west_loc ? 0 : (west_loc->ref ? west_loc->ref->GetPattern(EAST) : ANY_COLOR),
-        !north_loc ? 0 : (north_loc->ref ? north_loc->ref->GetPattern(SOUTH) : ANY_COLOR));
-
-    auto it = neighbour_table.find(key);
-    if (it == neighbour_table.end())
-    {
-        return 0;
-    }
+    int east = board.GetNeighbourPattern(loc, EAST, ANY_COLOR);
+    int south = board.GetNeighbourPattern(loc, SOUTH, ANY_COLOR);
+    int west = board.GetNeighbourPattern(loc, WEST, ANY_COLOR);
+    int north = board.GetNeighbourPattern(loc, NORTH, ANY_COLOR);
 
     int feasible_count = 0;
     PieceRef* repre = nullptr;
-    for (auto& piece : it->second) {
-        if (!locations_map[piece->GetId()]) {
-            if (!forbidden_map[piece->GetId()][piece->GetDir()]){
-                repre = piece;
-                feasible_count += 1;
+    if (engine == CandidateEngine::BITSET) {
+        if (bitsets.Match(east, south, west, north, matched.data()) > 0) {
+            for (int bit = bitsets.Prev(matched.data(), -1); bit >= 0; bit = bitsets.Prev(matched.data(), bit)) {
+                auto piece = bitsets.GetRef(bit);
+                if (!stack.IsForbidden(piece)) {
+                    repre = piece;
+                    feasible_count += 1;
+                }
+            }
+        }
+    }
+    else {
+        for (auto& piece : candidates.Get(candidates.Encode(east, south, west, north))) {
+            if (!locations_map[piece->GetId()]) {
+                if (!stack.IsForbidden(piece)){
+                    repre = piece;
+                    feasible_count += 1;
+                }
             }
         }
     }
@@ -1157,13 +1027,14 @@ void Backtracker::Place(Board::Loc* loc, PieceRef* ref)
     LDEBUG("Placing %i at (%i, %i) [%i, %i, %i, %i]  dir=%i stack_size=%i\n",
         ref->GetId(), loc->x, loc->y, 
         ref->GetPattern(0), ref->GetPattern(1), ref->GetPattern(2), ref->GetPattern(3),
-        ref->GetDir(), static_cast<int>(stack.visited.size()) + 1);
+        ref->GetDir(), static_cast<int>(stack.Size()) + 1);
     board.PutPiece(loc, ref);
+    holes.Place(loc);
+    if (engine == CandidateEngine::BITSET) {
+        bitsets.Place(ref);
+    }
 #ifdef ROTATION_CHECK
-    rot_checker.Place(ref->GetPattern(0),
-        ref->GetPattern(1),
-        ref->GetPattern(2),
-        ref->GetPattern(3));
+    rot_checker.Place(board, loc);
 #endif
     switch (loc->type)
     {
@@ -1180,14 +1051,23 @@ void Backtracker::Place(Board::Loc* loc, PieceRef* ref)
         break;
     }
 
-    stack.visited.push(Stack::LevelInfo(pieces_count));
+    stack.Push();
+
+    if (nogoods || completions) {
+        int placed = static_cast<int>(stack.Size()) - 1;
+        uint64_t key = frontier_keys[placed - 1];
+        for (auto& edge : frontier_changes[placed]) {
+            key ^= GetEdgeKey(edge.first, edge.second);
+        }
+        frontier_keys[placed] = key;
+    }
 
     // update scores cache (specific for position in path)
-    if (scores.size() < stack.visited.size() - 1) {
+    if (scores.size() < stack.Size() - 1) {
         int prev_score = scores.empty() ? 0 : scores.back();
         int neighbours = 0;
         for (int i = 0; i < 4; ++i) {
-            neighbours += (loc->neighbours[i] && loc->neighbours[i]->ref) ? 1 : 0;
+            neighbours += board.GetNeighbour(loc, i)->IsPlaced() ? 1 : 0;
         }
         int new_score = prev_score + neighbours;
         scores.push_back(new_score);
@@ -1198,6 +1078,7 @@ void Backtracker::Place(Board::Loc* loc, PieceRef* ref)
             for (auto& callback : on_new_best) {
                 callback->Call(board);
             }
+            reported = true;
         }
     }    
 }
@@ -1208,9 +1089,18 @@ bool Backtracker::Backtrack()
         return false;
     }
 
-    Board::Loc* removing = path[stack.visited.size() - 2];
-    stack.visited.pop();
-    int stack_pos = static_cast<int>(stack.visited.size());
+    // nothing found below the position being left
+    int placed = static_cast<int>(stack.Size()) - 1;
+    if (nogoods && nogood_entered[placed] == solved_or_split &&
+        nogood_placements - nogood_start[placed] >= NOGOOD_MIN_PLACEMENTS) {
+        nogoods->Add(board.GetRemainingHash() ^ frontier_keys[placed]);
+        nogood_levels[placed] = true;
+        ++nogood_stores;
+    }
+
+    Board::Loc* removing = path[stack.Size() - 2];
+    stack.Pop();
+    int stack_pos = static_cast<int>(stack.Size());
 
     // update statistics
     stats.Update(stack_pos);
@@ -1219,29 +1109,33 @@ bool Backtracker::Backtrack()
         removing->ref->GetId(), 
         removing->x, removing->y, 
         removing->ref->GetPattern(0), removing->ref->GetPattern(1), removing->ref->GetPattern(2), removing->ref->GetPattern(3),
-        static_cast<int>(stack.visited.size()));
+        static_cast<int>(stack.Size()));
 
-    stack.visited.top().forbidden[removing->ref->GetId()][removing->ref->GetDir()] = true;
+    stack.Forbid(removing->ref);
+    Unplace(removing);
 
-    unplaced_pieces.insert(removing->ref);
-    if (removing->type == Board::LocType::CORNER) {
+    return true;
+}
+
+void Backtracker::Unplace(Board::Loc* loc)
+{
+    if (loc->type == Board::LocType::CORNER) {
         stats.UpdateUnplacedCorners(1);
     }
-    else if (removing->type == Board::LocType::EDGE) {
+    else if (loc->type == Board::LocType::EDGE) {
         stats.UpdateUnplacedEdges(1);
     }
     else {
         stats.UpdateUnplacedInner(1);
     }
 #ifdef ROTATION_CHECK
-    rot_checker.Unplace(removing->ref->GetPattern(0),
-        removing->ref->GetPattern(1),
-        removing->ref->GetPattern(2),
-        removing->ref->GetPattern(3));
+    rot_checker.Unplace(board, loc);
 #endif
-    board.RemovePiece(removing);
-
-    return true;
+    if (engine == CandidateEngine::BITSET) {
+        bitsets.Unplace(loc->ref);
+    }
+    board.RemovePiece(loc);
+    holes.Unplace();
 }
 
 Stats& Backtracker::GetStats()
@@ -1258,3 +1152,261 @@ void Backtracker::RegisterOnNewBest(CallbackOnSolve* callback)
 {
     on_new_best.push_back(callback);
 }
+
+void Backtracker::RegisterOnSplit(CallbackOnSolve* callback, int depth)
+{
+    on_split = callback;
+    split_depth = depth;
+}
+
+void Backtracker::SetNogoods(NogoodTable* table)
+{
+    nogoods = nullptr;
+    if (!table || !InitFrontier()) {
+        return;
+    }
+
+    nogood_entered.assign(path.size() + 1, -1);
+    nogood_start.assign(path.size() + 1, 0);
+    nogood_levels.assign(path.size() + 1, false);
+    nogoods = table;
+}
+
+void Backtracker::SetCompletions(CompletionTable* table, int cells)
+{
+    completions = nullptr;
+    if (!table || cells <= 0 || !InitFrontier()) {
+        return;
+    }
+
+    // not below the levels placed before the search
+    cells = std::min(cells, CompletionTable::MAX_PLACEMENTS);
+    completion_level = std::max(static_cast<int>(path.size()) - cells, static_cast<int>(stack.start_size));
+
+    int width = board.GetPuzzleDef()->GetWidth();
+    std::vector<int> position(board.GetPuzzleDef()->GetHeight() * width);
+    for (int i = 0; i < static_cast<int>(path.size()); ++i) {
+        position[path[i]->x * width + path[i]->y] = i;
+    }
+    path_scores.assign(path.size(), 0);
+    for (int i = 0; i < static_cast<int>(path.size()); ++i) {
+        int neighbours = 0;
+        for (int dir = 0; dir < 4; ++dir) {
+            auto neighbour = board.GetNeighbour(path[i], dir);
+            if (neighbour->type != Board::LocType::FRAME && position[neighbour->x * width + neighbour->y] < i) {
+                ++neighbours;
+            }
+        }
+        path_scores[i] = (i ? path_scores[i - 1] : 0) + neighbours;
+    }
+    completions = table;
+}
+
+bool Backtracker::InitFrontier()
+{
+    int height = board.GetPuzzleDef()->GetHeight();
+    int width = board.GetPuzzleDef()->GetWidth();
+    // positions are only comparable with path fixed in advance
+    if (static_cast<int>(path.size()) != height * width) {
+        return false;
+    }
+    if (!frontier_keys.empty()) {
+        return true;
+    }
+
+    std::vector<int> position(height * width);
+    for (int i = 0; i < static_cast<int>(path.size()); ++i) {
+        position[path[i]->x * width + path[i]->y] = i;
+    }
+
+    // placing piece removes edges facing it from frontier and adds its edges
+    // facing locations later in path
+    frontier_changes.assign(path.size() + 1, std::vector< std::pair<Board::Loc*, int> >());
+    for (int i = 0; i < static_cast<int>(path.size()); ++i) {
+        for (int dir = 0; dir < 4; ++dir) {
+            auto neighbour = board.GetNeighbour(path[i], dir);
+            if (neighbour->type == Board::LocType::FRAME) {
+                continue;
+            }
+            int j = position[neighbour->x * width + neighbour->y];
+            if (j < i) {
+                frontier_changes[i + 1].push_back(std::make_pair(neighbour, (dir + 2) % 4));
+            }
+            else {
+                frontier_changes[i + 1].push_back(std::make_pair(path[i], dir));
+            }
+        }
+    }
+
+    frontier_keys.assign(path.size() + 1, 0);
+    InitFrontierKeys();
+    return true;
+}
+
+void Backtracker::InitFrontierKeys()
+{
+    for (int placed = 1; placed < static_cast<int>(stack.Size()); ++placed) {
+        frontier_keys[placed] = frontier_keys[placed - 1];
+        for (auto& edge : frontier_changes[placed]) {
+            frontier_keys[placed] ^= GetEdgeKey(edge.first, edge.second);
+        }
+    }
+}
+
+void Backtracker::Save(Checkpoint& checkpoint)
+{
+    checkpoint.Put(CHECKPOINT_KIND);
+    checkpoint.Put(static_cast<int64_t>(state));
+    checkpoint.Put(highest_score);
+
+    // forbidden rotations of each level above hints, followed by the piece
+    // placed on it (except the top one)
+    std::vector<int> forbidden;
+    int count = static_cast<int>(stack.Size()) - stack.start_size;
+    checkpoint.Put(count);
+    for (int level = stack.start_size - 1; level < static_cast<int>(stack.Size()); ++level) {
+        stack.GetForbidden(level, forbidden);
+        checkpoint.Put(static_cast<int64_t>(forbidden.size()));
+        for (auto code : forbidden) {
+            checkpoint.Put(code);
+        }
+        if (level + 1 < static_cast<int>(stack.Size())) {
+            auto ref = path[level]->ref;
+            checkpoint.Put(ref->GetId());
+            checkpoint.Put(ref->GetDir());
+        }
+    }
+
+    stats.Save(checkpoint);
+}
+
+bool Backtracker::Load(Checkpoint& checkpoint)
+{
+    if (checkpoint.GetInt() != CHECKPOINT_KIND) {
+        return false;
+    }
+    auto saved_state = static_cast<State>(checkpoint.GetInt());
+    int saved_highest_score = static_cast<int>(checkpoint.GetInt());
+
+    auto& locations_map = board.GetLocations();
+    int count = static_cast<int>(checkpoint.GetInt());
+    if (!checkpoint.IsValid() || count < 0 || stack.Size() - 1 + count > path.size()) {
+        return false;
+    }
+    for (int i = 0; i <= count; ++i) {
+        int forbidden = static_cast<int>(checkpoint.GetInt());
+        for (int k = 0; k < forbidden && checkpoint.IsValid(); ++k) {
+            int code = static_cast<int>(checkpoint.GetInt());
+            if (code < 4 || code >= 4 * (pieces_count + 1)) {
+                return false;
+            }
+            stack.Forbid(board.GetRef(code / 4, code % 4));
+        }
+        if (i == count) {
+            break;
+        }
+
+        int id = static_cast<int>(checkpoint.GetInt());
+        int dir = static_cast<int>(checkpoint.GetInt());
+        if (!checkpoint.IsValid() || id < 1 || id > pieces_count || dir < 0 || dir > 3 || locations_map[id]) {
+            return false;
+        }
+        Place(path[stack.Size() - 1], board.GetRef(id, dir));
+    }
+
+    state = saved_state;
+    highest_score = saved_highest_score;
+    return stats.Load(checkpoint) && checkpoint.IsValid();
+}
+
+void Backtracker::GetPlacements(std::vector<HintDef>& placements) const
+{
+    placements.clear();
+    int hints = static_cast<int>(board.GetPuzzleDef()->GetHints().size());
+    for (int level = hints; level < static_cast<int>(stack.Size()) - 1; ++level) {
+        auto loc = path[level];
+        placements.push_back(HintDef(loc->x, loc->y, loc->ref->GetId(), loc->ref->GetDir()));
+    }
+}
+
+bool Backtracker::Replay(const std::vector<HintDef>& placements)
+{
+    // levels of previously replayed subtree are removed first, what was
+    // explored in it is forgotten
+    size_t hints = board.GetPuzzleDef()->GetHints().size();
+    while (stack.Size() > hints + 1) {
+        Board::Loc* removing = path[stack.Size() - 2];
+        stack.Pop();
+        Unplace(removing);
+    }
+    // forbidden rotations of the first level belong to the previous subtree
+    stack.Pop();
+    stack.Push();
+    stack.start_size = static_cast<int>(stack.Size());
+    stats.Clear();
+    state = State::SEARCHING;
+
+    auto& locations_map = board.GetLocations();
+    for (auto& placement : placements) {
+        if (stack.Size() > path.size()) {
+            return false;
+        }
+        auto loc = path[stack.Size() - 1];
+        if (loc->x != placement.x || loc->y != placement.y || placement.id < 1 || placement.id > pieces_count ||
+            placement.dir < 0 || placement.dir > 3 || locations_map[placement.id]) {
+            return false;
+        }
+        Place(loc, board.GetRef(placement.id, placement.dir));
+    }
+    stack.start_size = static_cast<int>(stack.Size());
+    return true;
+}
+
+bool Backtracker::ReplaceHints(const std::vector<HintDef>& hints)
+{
+    auto def = board.GetPuzzleDef();
+    if (state != State::FINISHED || stack.Size() != static_cast<size_t>(stack.start_size)) {
+        return false;
+    }
+    for (auto& hint : hints) {
+        if (hint.x < 0 || hint.x >= def->GetHeight() || hint.y < 0 || hint.y >= def->GetWidth() ||
+            hint.id < 1 || hint.id > pieces_count || !board.GetLocation(hint.x, hint.y)->hint) {
+            return false;
+        }
+    }
+
+    // all removed first, pieces may move between the locations
+    for (auto& hint : hints) {
+        auto loc = board.GetLocation(hint.x, hint.y);
+        if (!loc->ref) {
+            return false;
+        }
+        if (engine == CandidateEngine::BITSET) {
+            bitsets.Unplace(loc->ref);
+        }
+        board.RemovePiece(loc);
+    }
+    auto& locations_map = board.GetLocations();
+    for (auto& hint : hints) {
+        if (locations_map[hint.id]) {
+            return false;
+        }
+        board.PutPiece(hint.id, hint.x, hint.y, (hint.dir != -1) ? hint.dir : 0);
+        if (engine == CandidateEngine::BITSET) {
+            bitsets.Place(board.GetLocation(hint.x, hint.y)->ref);
+        }
+    }
+    holes.Reset();
+#ifdef ROTATION_CHECK
+    rot_checker.Init(board);
+#endif
+    if (!frontier_keys.empty()) {
+        InitFrontierKeys();
+    }
+
+    // forbidden rotations of the first path location belong to previous pieces
+    stack.Pop();
+    stack.Push();
+    state = State::SEARCHING;
+    return true;
+}
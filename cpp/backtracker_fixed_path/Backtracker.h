@@ -1,45 +1,124 @@
 #pragma once
 
+#include <ctime>
 #include "Board.h"
+#include "Checkpoint.h"
+#include "CallbackOnSolve.h"
 #include "MpfWrapper.h"
 #include "Stack.h"
 #include "Stats.h"
 #include "ColorAxisCounts.h"
+#include "CandidateTable.h"
+#include "CandidateBitsets.h"
+#include "Holes.h"
+#include "NogoodTable.h"
+#include "CompletionTable.h"
+
+// backtrack when remaining sides cannot cover colours facing empty locations,
+// with the path fixed the candidates already check most of it, so it cuts
+// below 1% of nodes and does not pay off
+//#define ROTATION_CHECK
 
 namespace edge {
 
 namespace backtracker {
 
-class CallbackOnSolve {
-public:
-    virtual void Call(Board& board) = 0;
-
-};
-
 class Backtracker {
 public:
     Backtracker(Board& board,
         std::set<std::pair<int, int>>* pieces_map = nullptr,
         bool find_all = false,
-        const std::string& rotations_file = "");
+        const std::string& rotations_file = "",
+        CandidateEngine engine = CandidateEngine::TABLE);
 
     bool Step();
 
+    // runs steps until node_budget is spent, deadline (as returned by time,
+    // 0 for none) passes, solution or new best is found or the search ends,
+    // number of steps done is stored in nodes, returns false once finished
+    bool Run(long long node_budget, time_t deadline, long long& nodes);
+
     Stats& GetStats();
 
     void RegisterOnSolve(CallbackOnSolve* callback);
 
     void RegisterOnNewBest(CallbackOnSolve* callback);
 
+    // positions reaching given depth below the start are handed to the
+    // callback and not searched any further, used to split the search
+    void RegisterOnSplit(CallbackOnSolve* callback, int depth);
+
+    // positions whose subtree was searched without finding a solution are
+    // stored into the table (possibly shared with other searches of the same
+    // puzzle) and cut when reached again, to be called before the first step,
+    // only used with path fixed in advance, statistics are added to the table
+    // at the end of each Run
+    void SetNogoods(NogoodTable* table);
+
+    // positions with given number of path locations left are completed by
+    // separate plain search once, number of placements it reaches is stored
+    // into the table (possibly shared with other searches of the same puzzle)
+    // and looked up when reached again, only subtrees leading to a solution or
+    // new best are then searched, to be called before the first step, only used
+    // with path fixed in advance, statistics are added to the table at the end
+    // of each Run
+    void SetCompletions(CompletionTable* table, int cells);
+
+    // stores complete search state, to be called between steps
+    void Save(Checkpoint& checkpoint);
+
+    // continues search stored by Save, to be called right after construction
+    // with the same random seed and before registering callbacks, returns
+    // false if the checkpoint does not match this search
+    bool Load(Checkpoint& checkpoint);
+
+    // placements above hints in the order they were made
+    void GetPlacements(std::vector<HintDef>& placements) const;
+
+    // places pieces as ordinary levels along the path (as returned by
+    // GetPlacements of the same search), search then stays within their
+    // subtree, to be called right after construction (before registering
+    // callbacks, nogoods and completions) or once the previously replayed
+    // subtree is finished, which is then removed together with its
+    // statistics, returns false if the placements do not follow the path
+    bool Replay(const std::vector<HintDef>& placements);
+
+    // puts other pieces on (some of) the hint locations and searches again
+    // from the start, explored statistics keep adding up, used to search
+    // interiors of many frames by one search, to be called once the search
+    // finished, returns false if the pieces do not fit the hint locations
+    // (the search cannot continue then)
+    bool ReplaceHints(const std::vector<HintDef>& hints);
+
 private:
+    static const int DEADLINE_CHECK_NODES = 0x1000; // how often Run checks the time
+    static const int NOGOOD_MIN_PLACEMENTS = 64; // smaller subtrees are cheaper to search again than to store
+
+    bool Search();
+
+    void Unwind();
+
     int CheckFeasible(Board::Loc*& feasible_location,
         PieceRef*& feasible_piece);
 
     void Place(Board::Loc* loc, PieceRef* ref);
 
+    uint64_t GetEdgeKey(const Board::Loc* loc, int dir) const;
+
+    // prepares keys of positions, false if path is not fixed
+    bool InitFrontier();
+
+    // keys of levels placed before the search (hints or loaded checkpoint)
+    void InitFrontierKeys();
+
+    // most placements reachable from path location at index on
+    int Complete(int index);
+
     bool Backtrack();
 
-    int EncodePatterns(int east, int south, int west, int north);
+    // removes piece of loc from board and structures following it, stack
+    // level is left to the caller
+    void Unplace(Board::Loc* loc);
 
 private:
     enum class State {
@@ -50,24 +129,52 @@ private:
 
     Board& board;
     State state;
+    CandidateEngine engine;
     Stack stack;
     Stats stats;
 #ifdef ROTATION_CHECK
     ColorAxisCounts rot_checker;
 #endif
     std::vector<Board::Loc*> path; 
-    std::vector < std::vector<Board::Loc*>> connected_locations; // cached locations for given position
     std::vector< int > scores; // cached scores according to path
     int pieces_count;
 
-    std::set< PieceRef* > unplaced_pieces;
-    std::unordered_map<int, std::vector< PieceRef*>> neighbour_table;
+    CandidateTable candidates;
+    Holes holes; // candidate counts of locations next to placed pieces
+    CandidateBitsets bitsets;
+    std::vector< uint64_t > matched; // scratch bitset for bitsets engine
     int highest_score;
+    bool reported; // solution or new best found in current Run
     bool find_all;
     bool connecting;
 
     std::vector< CallbackOnSolve* > on_solve;
     std::vector< CallbackOnSolve* > on_new_best;
+    CallbackOnSolve* on_split;
+    int split_depth;
+
+    // the rest of the search only depends on remaining pieces and patterns
+    // facing unplaced locations (frontier), the key of position is hash of
+    // remaining pieces kept by board xor hash of the frontier
+    NogoodTable* nogoods;
+    std::vector< std::vector< std::pair<Board::Loc*, int> > > frontier_changes; // edges entering or leaving frontier by placing on path
+    std::vector< uint64_t > frontier_keys; // for number of placed pieces
+    std::vector< long long > nogood_entered; // solved_or_split when it was entered, -1 if unknown
+    std::vector< long long > nogood_start; // nogood_placements when it was entered
+    std::vector< bool > nogood_levels; // levels with some stored position, others are not probed
+    long long solved_or_split; // subtrees with solution or searched elsewhere
+    long long nogood_placements;
+    long long nogood_probes;
+    long long nogood_hits;
+    long long nogood_stores;
+
+    CompletionTable* completions;
+    int completion_level; // number of placed pieces at which it is probed
+    std::vector< int > path_scores; // score after placing each path location
+    long long completion_probes;
+    long long completion_hits;
+    long long completion_stores;
+    long long completion_nodes;
 
 };
 
@@ -0,0 +1,199 @@
+#include "Holes.h"
+
+using namespace edge::backtracker;
+
+void Holes::Init(Board& board, const CandidateTable& table, const std::vector< PieceRef* >& allowed)
+{
+    auto def = board.GetPuzzleDef();
+    this->board = &board;
+    this->table = &table;
+    origin = board.GetLocation(-1, -1);
+
+    rotations.assign(def->GetPieceCount() + 1, std::vector< uint32_t >());
+    colors.assign(def->GetPieceCount() + 1, 0);
+    for (auto ref : allowed) {
+        rotations[ref->GetId()].push_back(ref->GetPatterns());
+        colors[ref->GetId()] = Colors(ref->GetPatterns());
+    }
+
+    // reserved for the deepest search, so that placements never allocate,
+    // each saves its location, its neighbours and at most every other hole
+    int cells = def->GetHeight() * def->GetWidth();
+    members.reserve(cells);
+    saved.reserve(static_cast<size_t>(cells) * (cells + 5));
+    marks.reserve(cells);
+
+    Reset();
+}
+
+void Holes::Reset()
+{
+    auto def = board->GetPuzzleDef();
+    blocked = 0;
+    holes.assign((def->GetHeight() + 2) * (def->GetWidth() + 2), Hole{ nullptr, 0, -1 });
+    for (int x = -1; x <= def->GetHeight(); ++x) {
+        for (int y = -1; y <= def->GetWidth(); ++y) {
+            holes[Index(board->GetLocation(x, y))].loc = board->GetLocation(x, y);
+        }
+    }
+
+    members.clear();
+    saved.clear();
+    marks.clear();
+    for (int x = 0; x < def->GetHeight(); ++x) {
+        for (int y = 0; y < def->GetWidth(); ++y) {
+            auto loc = board->GetLocation(x, y);
+            if (loc->ref) {
+                continue;
+            }
+            for (int dir = 0; dir < 4; ++dir) {
+                if (board->GetNeighbour(loc, dir)->IsPlaced()) {
+                    int hole = Index(loc);
+                    Join(hole);
+                    Refresh(hole);
+                    SetCount(hole, Count(hole));
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void Holes::Place(Board::Loc* loc)
+{
+    // neighbours are counted again from scratch, keep their previous state
+    int hole = Index(loc);
+    marks.push_back(saved.size());
+    Save(hole);
+    for (int dir = 0; dir < 4; ++dir) {
+        auto neighbour = board->GetNeighbour(loc, dir);
+        if (!neighbour->ref) {
+            Save(Index(neighbour));
+        }
+    }
+
+    if (holes[hole].slot != -1) {
+        Leave(hole);
+    }
+
+    // other holes lose the piece where it fits, their counts are saved too,
+    // so that removal does not need to test the fit again
+    auto& fitting = rotations[loc->ref->GetId()];
+    uint64_t has = colors[loc->ref->GetId()];
+    for (auto& member : members) {
+        if (member.colors & ~has) {
+            continue;
+        }
+        int fits = 0;
+        for (auto patterns : fitting) {
+            fits += Fits(patterns, member) ? 1 : 0;
+        }
+        if (fits) {
+            Save(member.hole);
+            SetCount(member.hole, holes[member.hole].count - fits);
+        }
+    }
+
+    for (int dir = 0; dir < 4; ++dir) {
+        auto neighbour = board->GetNeighbour(loc, dir);
+        if (!neighbour->ref) {
+            int index = Index(neighbour);
+            if (holes[index].slot == -1) {
+                Join(index);
+            }
+            Refresh(index);
+            SetCount(index, Count(index));
+        }
+    }
+}
+
+void Holes::Unplace()
+{
+    // newest first, hole saved more than once ends with its oldest state
+    size_t mark = marks.back();
+    marks.pop_back();
+    while (saved.size() > mark) {
+        auto& item = saved.back();
+        auto& hole = holes[item.hole];
+        if (item.member) {
+            if (hole.slot == -1) {
+                Join(item.hole);
+            }
+            Refresh(item.hole);
+            SetCount(item.hole, item.count);
+        }
+        else if (hole.slot != -1) {
+            Leave(item.hole);
+        }
+        saved.pop_back();
+    }
+}
+
+int Holes::Index(const Board::Loc* loc) const
+{
+    return static_cast<int>(loc - origin);
+}
+
+void Holes::Save(int hole)
+{
+    saved.push_back(Saved{ hole, holes[hole].count, holes[hole].slot != -1 });
+}
+
+void Holes::Refresh(int hole)
+{
+    auto& item = holes[hole];
+    auto& member = members[item.slot];
+    member.facing = 0;
+    member.known = 0;
+    member.colors = 0;
+    for (int dir = 0; dir < 4; ++dir) {
+        auto neighbour = board->GetNeighbour(item.loc, dir);
+        if (neighbour->ref) {
+            auto pattern = neighbour->ref->GetPattern((dir + 2) % 4);
+            member.facing |= static_cast<uint32_t>(pattern) << (8 * dir);
+            member.known |= 0xffu << (8 * dir);
+            member.colors |= 1ull << (pattern & 63);
+        }
+    }
+}
+
+int Holes::Count(int hole) const
+{
+    auto& item = holes[hole];
+    auto& locations_map = board->GetLocations();
+    int count = 0;
+    for (auto& piece : table->Get(table->Encode(board->GetNeighbourPattern(item.loc, EAST, ANY_COLOR),
+        board->GetNeighbourPattern(item.loc, SOUTH, ANY_COLOR),
+        board->GetNeighbourPattern(item.loc, WEST, ANY_COLOR),
+        board->GetNeighbourPattern(item.loc, NORTH, ANY_COLOR)))) {
+        if (!locations_map[piece->GetId()]) {
+            count += 1;
+        }
+    }
+    return count;
+}
+
+void Holes::SetCount(int hole, int count)
+{
+    auto& item = holes[hole];
+    blocked += (count == 0 ? 1 : 0) - (item.count == 0 ? 1 : 0);
+    item.count = count;
+}
+
+void Holes::Join(int hole)
+{
+    auto& item = holes[hole];
+    item.slot = static_cast<int>(members.size());
+    members.push_back(Member{ 0, 0, 0, hole });
+    item.count = -1; // not counted in blocked until set
+}
+
+void Holes::Leave(int hole)
+{
+    auto& item = holes[hole];
+    SetCount(hole, -1);
+    holes[members.back().hole].slot = item.slot;
+    members[item.slot] = members.back();
+    members.pop_back();
+    item.slot = -1;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Board.h"
+#include "CandidateTable.h"
+
+namespace edge {
+
+namespace backtracker {
+
+// Empty locations with at least one placed neighbour (holes), each with the
+// number of still available rotations fitting it. Placing a piece recounts only
+// its empty neighbours, from other holes the piece is subtracted where it
+// fits. Removing the piece restores the counts saved by its placement, so
+// placements must be undone in reverse order.
+class Holes
+{
+public:
+    // allowed - rotations registered in the table, pieces already on the
+    // board are not counted
+    void Init(Board& board, const CandidateTable& table, const std::vector< PieceRef* >& allowed);
+
+    // counts all holes again, after pieces were changed other than by Place
+    // and Unplace, with nothing placed by them
+    void Reset();
+
+    // must be called after the piece was put on the board
+    void Place(Board::Loc* loc);
+
+    // undoes the last Place, must be called after its piece was removed from
+    // the board
+    void Unplace();
+
+    // whether some hole has no rotation left
+    bool IsBlocked() const
+    {
+        return blocked > 0;
+    }
+
+private:
+    struct Hole {
+        Board::Loc* loc;
+        int count;
+        int slot; // position in members, -1 if not a hole
+    };
+
+    // kept apart from holes, so that placement walks only contiguous memory
+    struct Member {
+        uint32_t facing; // patterns of neighbours facing it, packed like PieceRef
+        uint32_t known; // 0xff for each side with neighbour (including frame)
+        uint64_t colors; // Colors() of facing patterns
+        int hole;
+    };
+
+    struct Saved {
+        int hole;
+        int count;
+        bool member;
+    };
+
+    int Index(const Board::Loc* loc) const;
+
+    // rotation fits when it matches all known sides and has no border
+    // pattern facing empty neighbour, the same as CandidateTable lookup
+    static bool Fits(uint32_t patterns, const Member& member)
+    {
+        uint32_t open = patterns | member.known; // zero byte is border facing empty neighbour
+        return ((patterns ^ member.facing) & member.known) == 0 &&
+            ((open - 0x01010101u) & ~open & 0x80808080u) == 0;
+    }
+
+    // bit for each pattern (modulo 64), piece can fit only holes whose
+    // facing colors are subset of its own
+    static uint64_t Colors(uint32_t patterns)
+    {
+        uint64_t colors = 0;
+        for (int dir = 0; dir < 4; ++dir) {
+            colors |= 1ull << ((patterns >> (8 * dir)) & 63);
+        }
+        return colors;
+    }
+
+    void Save(int hole);
+
+    void Refresh(int hole);
+
+    int Count(int hole) const;
+
+    void SetCount(int hole, int count);
+
+    void Join(int hole);
+
+    void Leave(int hole);
+
+    Board* board;
+    const CandidateTable* table;
+    const Board::Loc* origin; // first location of the board including frame
+    int blocked; // holes with no rotation left
+    std::vector< Hole > holes; // by location
+    std::vector< Member > members; // current holes
+    std::vector< std::vector< uint32_t > > rotations; // piece id -> patterns of allowed rotations
+    std::vector< uint64_t > colors; // piece id -> Colors() of its patterns
+    std::vector< Saved > saved; // states before placements, newest last
+    std::vector< size_t > marks; // saved size before each placement
+
+};
+
+}
+
+}
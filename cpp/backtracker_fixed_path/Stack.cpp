@@ -1,13 +1,57 @@
+#include <algorithm>
 #include "Stack.h"
 
 using namespace edge::backtracker;
 
 bool Stack::IsEmpty() {
     // empty == only root, plus possible hints
-    return visited.size() == start_size;
+    return size == start_size;
 }
 
-Stack::Stack() : start_size(1)
+Stack::Stack() : start_size(1), stride(0), size(0), generation(0)
 {
-    visited.push(LevelInfo(0)); // root
+}
+
+void Stack::Init(int depth, int pieces_count)
+{
+    // root + one level per placed piece
+    stride = 4 * (pieces_count + 1);
+    levels.assign(depth + 1, LevelInfo{ 0 });
+    stamps.assign(levels.size() * stride, 0);
+    size = 0;
+    generation = 0;
+    Push(); // root
+}
+
+void Stack::Push()
+{
+    if (++generation == 0) {
+        // wrapped around, old stamps could match again
+        std::fill(stamps.begin(), stamps.end(), 0);
+        for (int level = 0; level < size; ++level) {
+            levels[level].generation = ++generation;
+        }
+        ++generation;
+    }
+    levels[size++].generation = generation;
+}
+
+void Stack::Pop()
+{
+    --size;
+}
+
+size_t Stack::Size() const
+{
+    return static_cast<size_t>(size);
+}
+
+void Stack::GetForbidden(int level, std::vector<int>& out) const
+{
+    out.clear();
+    for (int code = 0; code < stride; ++code) {
+        if (stamps[level * stride + code] == levels[level].generation) {
+            out.push_back(code);
+        }
+    }
 }
@@ -1,37 +1,64 @@
 #pragma once
 
-#include <unordered_map>
-#include <unordered_set>
-#include <stack>
+#include <cstdint>
+#include <vector>
 #include "Board.h"
 
 namespace edge {
 
 namespace backtracker {
 
+// Stack of levels along the path, allocated once for the whole depth.
+// Forbidden rotations of a level are stamped with its generation, so pushing
+// new level only takes new generation instead of clearing previous content.
 class Stack {
 public:
 
     struct LevelInfo {
-        std::vector< std::array<bool, 4> > forbidden;
-
-        LevelInfo(int pieces_count)
-        {
-            forbidden.resize(pieces_count + 1);
-        }
+        uint32_t generation;
     };
 
+    Stack();
+
+    void Init(int depth, int pieces_count);
+
+    void Push();
+
+    void Pop();
+
+    size_t Size() const;
+
     bool IsEmpty();
 
-    Stack();
+    bool IsForbidden(const PieceRef* ref) const
+    {
+        return stamps[Top() * stride + ref->GetId() * 4 + ref->GetDir()] == levels[Top()].generation;
+    }
+
+    void Forbid(const PieceRef* ref)
+    {
+        stamps[Top() * stride + ref->GetId() * 4 + ref->GetDir()] = levels[Top()].generation;
+    }
+
+    // forbidden rotations of given level as id * 4 + dir
+    void GetForbidden(int level, std::vector<int>& out) const;
 
-    std::stack<LevelInfo> visited;
     int start_size;
 
 private:
+    int Top() const
+    {
+        return size - 1;
+    }
+
+    std::vector< LevelInfo > levels;
+    std::vector< uint32_t > stamps; // [level][piece id][dir]
+    int stride;
+    int size;
+    uint32_t generation;
 
 };
 
 }
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <gmp.h>
+#include "PuzzleDef.h"
+#include "Board.h"
+#include "Backtracker.h"
+
+// counts heap allocations (including GMP) done while searching, every node
+// must be served from memory reserved before the search
+
+static bool counting = false;
+static long long allocations = 0;
+
+void* operator new(size_t size)
+{
+    if (counting) {
+        ++allocations;
+    }
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+static void* GmpAlloc(size_t size)
+{
+    if (counting) {
+        ++allocations;
+    }
+    return malloc(size);
+}
+
+static void* GmpRealloc(void* p, size_t, size_t size)
+{
+    if (counting) {
+        ++allocations;
+    }
+    return realloc(p, size);
+}
+
+static void GmpFree(void* p, size_t)
+{
+    free(p);
+}
+
+static const long long WARMUP_NODES = 1000000;
+static const long long MEASURED_NODES = 4000000;
+
+// returns allocations per million nodes
+static double Measure(const std::string& def_file, const std::string& hints_file,
+    edge::backtracker::CandidateEngine engine)
+{
+    edge::PuzzleDef def = edge::PuzzleDef::Load(def_file, hints_file);
+    edge::Board board(&def);
+    edge::backtracker::Backtracker backtracker(board, nullptr, true, "", engine);
+
+    // first descent grows the weights of statistics once
+    long long total = 0;
+    long long nodes = 0;
+    bool running = true;
+    while (running && total < WARMUP_NODES) {
+        running = backtracker.Run(WARMUP_NODES - total, 0, nodes);
+        total += nodes;
+    }
+
+    allocations = 0;
+    counting = true;
+    total = 0;
+    while (running && total < MEASURED_NODES) {
+        running = backtracker.Run(MEASURED_NODES - total, 0, nodes);
+        total += nodes;
+    }
+    counting = false;
+
+    printf("%s: nodes: %lli, allocations: %lli\n",
+        engine == edge::backtracker::CandidateEngine::BITSET ? "bitset" : "table", total, allocations);
+    return total ? 1e6 * allocations / total : 0.0;
+}
+
+// arguments: definition, [hints]
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        printf("Missing puzzle definition argument\n");
+        return 1;
+    }
+    std::string hints_file = (argc > 2) ? argv[2] : "";
+
+    mp_set_memory_functions(GmpAlloc, GmpRealloc, GmpFree);
+
+    int failed = 0;
+    for (auto engine : { edge::backtracker::CandidateEngine::TABLE, edge::backtracker::CandidateEngine::BITSET }) {
+        if (Measure(argv[1], hints_file, engine) != 0.0) {
+            printf("FAILED: search allocates per node\n");
+            ++failed;
+        }
+    }
+    return failed;
+}
@@ -3,6 +3,14 @@
 #include "PuzzleDef.h"
 #include "Board.h"
 #include "Backtracker.h"
+#include "ParallelSearch.h"
+#include "WorkUnits.h"
+#include "Args.h"
+#include "Checkpoint.h"
+#include "NogoodTable.h"
+#include "CompletionTable.h"
+#include "FrameSolver.h"
+#include "FrameCache.h"
 #include <time.h>
 #include <Windows.h>
 
@@ -61,11 +69,284 @@ public:
 
     }
 
+    int GetCount() const
+    {
+        return counter;
+    }
+
 private:
     std::string prefix;
     int counter;
 };
 
+class AddUnit : public edge::backtracker::CallbackOnSolve {
+public:
+    AddUnit(edge::backtracker::WorkUnits& units) : counter(0), units(units)
+    {
+    }
+
+    void Call(edge::Board& board)
+    {
+        units.Add(board);
+        ++counter;
+    }
+
+    int counter;
+
+private:
+    edge::backtracker::WorkUnits& units;
+};
+
+// forwards only positions better than any found so far, so that searches of
+// many small subproblems do not save each of their own best positions
+class BetterOnly : public edge::backtracker::CallbackOnSolve {
+public:
+    BetterOnly(NewBest& new_best) : new_best(new_best)
+    {
+    }
+
+    void Call(edge::Board& board)
+    {
+        if (board.GetScore() > new_best.max_score) {
+            new_best.Call(board);
+        }
+    }
+
+private:
+    NewBest& new_best;
+};
+
+static const long long RUN_NODES = 0x10000; // most steps done between checks of time
+
+void PrintNogoods(const edge::backtracker::NogoodTable* nogoods)
+{
+    if (!nogoods) {
+        return;
+    }
+    long long probes = nogoods->GetProbes();
+    long long hits = nogoods->GetHits();
+    printf("nogoods: hits %lli/%lli (%.2f%%), stored: %lli, memory: %i MB\n",
+        hits, probes, probes ? 100.0 * hits / probes : 0.0, nogoods->GetStores(),
+        static_cast<int>(nogoods->GetMemory() >> 20));
+}
+
+void PrintCompletions(const edge::backtracker::CompletionTable* completions)
+{
+    if (!completions) {
+        return;
+    }
+    long long probes = completions->GetProbes();
+    long long hits = completions->GetHits();
+    printf("completions: hits %lli/%lli (%.2f%%), stored: %lli, completing iters: %lli, memory: %i MB\n",
+        hits, probes, probes ? 100.0 * hits / probes : 0.0, completions->GetStores(), completions->GetNodes(),
+        static_cast<int>(completions->GetMemory() >> 20));
+}
+
+// writes every position at split depth as a work unit, the rest of the search
+// (positions failing before that depth) is stored as result of "split"
+void SplitUnits(edge::backtracker::WorkUnits& units, edge::Board& board, const std::string& rotations_file,
+    edge::backtracker::CandidateEngine engine, int split_depth, Solved& solved, NewBest& new_best,
+    edge::backtracker::NogoodTable* nogoods, edge::backtracker::CompletionTable* completions, int completion_cells)
+{
+    AddUnit add_unit(units);
+    edge::backtracker::Backtracker backtracker(board, nullptr, true, rotations_file, engine);
+    backtracker.SetNogoods(nogoods);
+    backtracker.SetCompletions(completions, completion_cells);
+    backtracker.RegisterOnSolve(&solved);
+    backtracker.RegisterOnNewBest(&new_best);
+    backtracker.RegisterOnSplit(&add_unit, split_depth);
+
+    edge::backtracker::WorkResult result;
+    long long nodes = 0;
+    while (backtracker.Run(RUN_NODES, 0, nodes)) {
+        result.nodes += nodes;
+    }
+    result.nodes += nodes;
+    result.best_score = new_best.max_score;
+    result.solutions = solved.GetCount();
+    backtracker.GetStats().GetExploredAbsExact(result.explored);
+    units.Finish("split", result);
+    printf("split into %i units\n", add_unit.counter);
+}
+
+// searches claimed units until there are none left
+void SolveUnits(edge::backtracker::WorkUnits& units, const edge::PuzzleDef& def, const std::string& rotations_file,
+    edge::backtracker::CandidateEngine engine, const std::string& prefix, edge::backtracker::NogoodTable* nogoods,
+    edge::backtracker::CompletionTable* completions, int completion_cells)
+{
+    std::string name;
+    std::vector<edge::HintDef> placements;
+    while (units.Claim(name, placements)) {
+        printf("solving %s\n", name.c_str());
+        edge::PuzzleDef unit_def = def;
+        for (auto& hint : placements) {
+            unit_def.AddHint(hint);
+        }
+        edge::Board board(&unit_def);
+
+        Solved solved(prefix + "_" + name);
+        NewBest new_best(prefix + "_" + name);
+        edge::backtracker::Backtracker backtracker(board, nullptr, true, rotations_file, engine);
+        backtracker.SetNogoods(nogoods);
+        backtracker.SetCompletions(completions, completion_cells);
+        backtracker.RegisterOnSolve(&solved);
+        backtracker.RegisterOnNewBest(&new_best);
+
+        edge::backtracker::WorkResult result;
+        long long nodes = 0;
+        while (backtracker.Run(RUN_NODES, 0, nodes)) {
+            result.nodes += nodes;
+        }
+        result.nodes += nodes;
+        result.best_score = new_best.max_score;
+        result.solutions = solved.GetCount();
+        backtracker.GetStats().GetExploredAbsExact(result.explored);
+        units.Finish(name, result);
+        PrintNogoods(nogoods);
+        PrintCompletions(completions);
+    }
+}
+
+// sums results of all finished units
+void SumUnits(edge::backtracker::WorkUnits& units, edge::Board& board)
+{
+    std::vector<edge::backtracker::WorkResult> results;
+    int waiting = 0;
+    std::vector<std::string> unfinished;
+    units.Collect(results, waiting, unfinished);
+
+    edge::backtracker::Stats stats;
+    stats.Init(board);
+    long long nodes = 0;
+    int best_score = 0;
+    int solutions = 0;
+    for (auto& result : results) {
+        nodes += result.nodes;
+        best_score = std::max(best_score, result.best_score);
+        solutions += result.solutions;
+        stats.Merge(result.explored);
+    }
+
+    std::string explAbs, explMax, explRatio;
+    stats.GetExploredAbs().PrintExp(explAbs);
+    stats.GetExploredRatio().PrintExp(explRatio);
+    stats.GetExploredMax().PrintExp(explMax);
+    printf("units finished: %i, claimed: %i, waiting: %i\n", static_cast<int>(results.size()),
+        static_cast<int>(unfinished.size()), waiting);
+    // claimed units of stopped processes are never finished by others
+    for (auto& file : unfinished) {
+        printf("claimed without result: %s\n", file.c_str());
+    }
+    if (!unfinished.empty() || waiting > 0) {
+        printf("search is not complete, sums below cover finished units only\n");
+    }
+    printf("max_score: %i, solutions: %i, iters: %lli, expl: %s/%s (%s)\n",
+        best_score, solutions, nodes, explAbs.c_str(), explMax.c_str(), explRatio.c_str());
+}
+
+// searches interior of every frame, frames are enumerated only once and kept in
+// the cache, so that restarted run continues with the first unsearched frame,
+// all frames are searched by one search with the frame pieces replaced
+void SearchFrames(const std::string& frames_file, const edge::PuzzleDef& def, const std::string& rotations_file,
+    edge::backtracker::CandidateEngine engine, Solved& solved, NewBest& new_best, edge::backtracker::NogoodTable* nogoods,
+    edge::backtracker::CompletionTable* completions, int completion_cells)
+{
+    edge::backtracker::FrameSolver frame_solver(&def);
+    edge::backtracker::FrameCache cache(frames_file, frame_solver.GetLength(), frame_solver.GetFingerprint());
+    std::vector<int> frame;
+    if (cache.GetCount() > 0 && !cache.IsComplete()) {
+        cache.Read(cache.GetCount() - 1, frame);
+        frame_solver.Seek(frame);
+    }
+    printf("frames cached: %lli%s, next: %lli\n", cache.GetCount(), cache.IsComplete() ? " (all)" : "", cache.GetNext());
+
+    // explored space of all interiors searched now, out of the whole puzzle
+    edge::Board whole(&def);
+    edge::backtracker::Stats explored;
+    explored.Init(whole);
+
+    BetterOnly better_only(new_best);
+    std::unique_ptr<edge::PuzzleDef> frame_def; // hints of the first frame mark frame locations
+    std::unique_ptr<edge::Board> board;
+    std::unique_ptr<edge::backtracker::Backtracker> backtracker;
+    long long total = 0;
+    long long searched = 0;
+    int start = (int)time(0);
+    int last_print = start;
+    std::vector<edge::HintDef> placements;
+    for (long long index = cache.GetNext(); ; ++index) {
+        if (index == cache.GetCount()) {
+            if (cache.IsComplete() || !frame_solver.Next(frame)) {
+                cache.SetComplete();
+                break;
+            }
+            cache.Append(frame);
+        }
+        else {
+            cache.Read(index, frame);
+        }
+
+        frame_solver.GetPlacements(frame, placements);
+        if (!backtracker) {
+            frame_def.reset(new edge::PuzzleDef(def));
+            for (auto& hint : placements) {
+                frame_def->AddHint(hint);
+            }
+            board.reset(new edge::Board(frame_def.get()));
+            backtracker.reset(new edge::backtracker::Backtracker(*board, nullptr, true, rotations_file, engine));
+            backtracker->SetNogoods(nogoods);
+            backtracker->SetCompletions(completions, completion_cells);
+            backtracker->RegisterOnSolve(&solved);
+            backtracker->RegisterOnNewBest(&better_only);
+        }
+        else if (!backtracker->ReplaceHints(placements)) {
+            throw std::exception("Frame does not fit the search!");
+        }
+
+        int solutions = solved.GetCount();
+        long long nodes = 0;
+        while (backtracker->Run(RUN_NODES, 0, nodes)) {
+            total += nodes;
+        }
+        total += nodes;
+        ++searched;
+        if (solved.GetCount() > solutions) {
+            printf("frame %lli: solutions: %i\n", index, solved.GetCount() - solutions);
+        }
+        cache.SetNext(index + 1);
+
+        int now = (int)time(0);
+        if (now - last_print >= 10) {
+            cache.Flush();
+            std::string explAbs, explMax, explRatio;
+            explored.Clear();
+            explored.Merge(backtracker->GetStats());
+            explored.GetExploredAbs().PrintExp(explAbs);
+            explored.GetExploredRatio().PrintExp(explRatio);
+            explored.GetExploredMax().PrintExp(explMax);
+            printf("frames searched: %lli (next %lli), max_score: %i, solutions: %i, iters: %lli, expl: %s/%s (%s)\n",
+                searched, index + 1, new_best.max_score, solved.GetCount(), total, explAbs.c_str(), explMax.c_str(),
+                explRatio.c_str());
+            last_print = now;
+        }
+    }
+    cache.Flush();
+
+    std::string explAbs, explMax, explRatio;
+    explored.Clear();
+    if (backtracker) {
+        explored.Merge(backtracker->GetStats());
+    }
+    explored.GetExploredAbs().PrintExp(explAbs);
+    explored.GetExploredRatio().PrintExp(explRatio);
+    explored.GetExploredMax().PrintExp(explMax);
+    printf("finished in %i sec, frames: %lli (searched now %lli)\n", (int)time(0) - start, cache.GetCount(), searched);
+    printf("max_score: %i, solutions: %i, iters: %lli, expl: %s/%s (%s)\n", new_best.max_score, solved.GetCount(), total,
+        explAbs.c_str(), explMax.c_str(), explRatio.c_str());
+    PrintNogoods(nogoods);
+    PrintCompletions(completions);
+}
+
 int main(int argc, char* argv[])
 {
     std::random_device rd;
@@ -88,21 +369,86 @@ int main(int argc, char* argv[])
     //}
     printf("save_prefix: %s\n", prefix.c_str());
 
-    // fixed arguments for now
-    if (argc <= 1) {
+    // positional arguments: definition, [hints], [rotations]
+    edge::Args args(argc, argv);
+    auto& positional = args.GetPositional();
+    if (positional.empty()) {
         printf("Missing puzzle definition argument\n");
         return 1;
     }
 
-    std::string def_file = argv[1];
+    std::string def_file = positional[0];
     std::string hints_file = "";
-    if (argc > 2) {
-        hints_file = argv[2];
+    if (positional.size() > 1) {
+        hints_file = positional[1];
     }
 
     std::string rotations_file = "";
-    if (argc > 3) {
-        rotations_file = argv[3];
+    if (positional.size() > 2) {
+        rotations_file = positional[2];
+    }
+
+    // --engine=bitset selects bitset candidate intersection instead of table lookup
+    auto engine = (args.Get("engine") == "bitset") ?
+        edge::backtracker::CandidateEngine::BITSET : edge::backtracker::CandidateEngine::TABLE;
+
+    // --threads=N searches subtrees below --split-depth=K placements on N threads
+    int threads = args.GetInt("threads", 1);
+    int split_depth = args.GetInt("split-depth", 4);
+
+    // work units shared by multiple processes in given directory (started with
+    // the same definition, hints and rotations)
+    //   --split-units=DIR  writes units for positions at --split-depth
+    //   --solve-units=DIR  searches units until none is left
+    //   --sum-units=DIR    prints summary of finished units
+    //   --requeue-units=DIR makes units claimed by stopped processes waiting again
+    // --owner=NAME names the solving process in claimed units (default save
+    // prefix), restarted process with the same name continues its units first
+    std::string units_dir = args.Get("split-units", args.Get("solve-units", args.Get("sum-units",
+        args.Get("requeue-units"))));
+    std::string owner = args.Get("owner");
+
+    // --frames=FILE enumerates frames (border pieces) separately and searches
+    // interior of each, frames and progress are kept in FILE across restarts
+    std::string frames_file = args.Get("frames");
+
+    // --checkpoint=FILE stores search state every --checkpoint-interval seconds
+    // (default 60), with --resume the search stored in it is continued
+    std::string checkpoint_file = args.Get("checkpoint");
+    int checkpoint_interval = args.GetInt("checkpoint-interval", 60);
+    if (args.Has("resume") && checkpoint_file.empty()) {
+        printf("--resume needs --checkpoint\n");
+        return 1;
+    }
+    if (!checkpoint_file.empty() && (threads > 1 || !units_dir.empty() || !frames_file.empty())) {
+        // frames and units keep their own progress, threads none
+        printf("--checkpoint cannot be used with --threads, --frames or units\n");
+        return 1;
+    }
+    edge::backtracker::Checkpoint checkpoint(checkpoint_file);
+    bool resume = args.Has("resume") && !checkpoint_file.empty();
+    if (resume && !checkpoint.Load()) {
+        printf("Unable to load checkpoint %s\n", checkpoint_file.c_str());
+        return 1;
+    }
+
+    // --nogood-mb=N keeps positions searched without solution in table of N MB
+    // (shared by all threads), which are then cut when reached again
+    int nogood_mb = args.GetInt("nogood-mb", 0);
+    std::unique_ptr<edge::backtracker::NogoodTable> nogoods;
+    if (nogood_mb > 0) {
+        nogoods.reset(new edge::backtracker::NogoodTable(static_cast<size_t>(nogood_mb)));
+    }
+
+    // --completion-mb=N keeps in table of N MB how far positions with
+    // --completion-cells=K (default 16) path locations left can be completed,
+    // found by plain search, their subtrees are then only walked for solution
+    // or new best
+    int completion_mb = args.GetInt("completion-mb", 0);
+    int completion_cells = args.GetInt("completion-cells", 16);
+    std::unique_ptr<edge::backtracker::CompletionTable> completions;
+    if (completion_mb > 0) {
+        completions.reset(new edge::backtracker::CompletionTable(static_cast<size_t>(completion_mb)));
     }
 
     bool restarting = false; // disable to avoid restarting
@@ -110,8 +456,9 @@ int main(int argc, char* argv[])
     int restart_seconds = 2 * 60;
 
     while (true) {
+        // resumed search must see the same random sequence, seed is stored first
         std::random_device rd;
-        unsigned int seed = rd();
+        unsigned int seed = resume ? static_cast<unsigned int>(checkpoint.GetInt()) : rd();
         //seed = 1060869576; // debug
         printf("seed: %u\n", seed);
         srand(seed);
@@ -138,7 +485,88 @@ int main(int argc, char* argv[])
 
         Solved solved_callback(prefix);
         NewBest newbest_callback(prefix);
-        edge::backtracker::Backtracker backtracker(board, pMap, true, rotations_file);
+
+        if (!units_dir.empty()) {
+            edge::backtracker::WorkUnits units(units_dir, owner.empty() ? prefix : owner);
+            if (args.Has("split-units")) {
+                SplitUnits(units, board, rotations_file, engine, split_depth, solved_callback, newbest_callback, nogoods.get(),
+                    completions.get(), completion_cells);
+            }
+            else if (args.Has("solve-units")) {
+                SolveUnits(units, def, rotations_file, engine, prefix, nogoods.get(), completions.get(), completion_cells);
+            }
+            else if (args.Has("requeue-units")) {
+                printf("requeued units: %i\n", units.Requeue());
+            }
+            else {
+                SumUnits(units, board);
+            }
+            break;
+        }
+
+        if (!frames_file.empty()) {
+            SearchFrames(frames_file, def, rotations_file, engine, solved_callback, newbest_callback, nogoods.get(),
+                completions.get(), completion_cells);
+            break;
+        }
+
+        if (threads > 1) {
+            // restarting is not supported, each subtree is searched to the end
+            edge::backtracker::ParallelSearch<edge::backtracker::Backtracker> search(
+                board, true, rotations_file, engine, threads, split_depth);
+            search.RegisterOnSolve(&solved_callback);
+            search.RegisterOnNewBest(&newbest_callback);
+            auto table = nogoods.get();
+            auto completion_table = completions.get();
+            search.SetSolverSetup([table, completion_table, completion_cells](edge::backtracker::Backtracker& solver) {
+                solver.SetNogoods(table);
+                solver.SetCompletions(completion_table, completion_cells);
+            });
+
+            int start_absolute = (int)time(0);
+            search.Start();
+            long long last_steps = 0;
+            while (search.IsRunning()) {
+                Sleep(1000);
+
+                std::string explAbsLast, explAbs, explMax, explRatio;
+                auto& stats = search.GetStats();
+                stats.GetExploredAbsLast().PrintExp(explAbsLast);
+                stats.GetExploredAbs().PrintExp(explAbs);
+                stats.GetExploredRatio().PrintExp(explRatio);
+                stats.GetExploredMax().PrintExp(explMax);
+
+                long long steps = search.GetSteps();
+                printf("max_score: %i, iters: %lli (+%lli) "
+                    "expl: %s/%s (%s +%s)\n",
+                    newbest_callback.max_score, steps, steps - last_steps, explAbs.c_str(), explMax.c_str(), explRatio.c_str(), explAbsLast.c_str());
+                PrintNogoods(nogoods.get());
+                PrintCompletions(completions.get());
+                last_steps = steps;
+            }
+            search.Wait();
+
+            std::string explAbs, explMax, explRatio;
+            auto& stats = search.GetStats();
+            stats.GetExploredAbs().PrintExp(explAbs);
+            stats.GetExploredRatio().PrintExp(explRatio);
+            stats.GetExploredMax().PrintExp(explMax);
+            printf("finished in %i sec, total iterations: %lli\n", (int)time(0) - start_absolute, search.GetSteps());
+            printf("max_score: %i, explAbs: %s, explRatio: %s, explMax: %s\n",
+                newbest_callback.max_score, explAbs.c_str(), explRatio.c_str(), explMax.c_str());
+            PrintNogoods(nogoods.get());
+            PrintCompletions(completions.get());
+            break;
+        }
+
+        edge::backtracker::Backtracker backtracker(board, pMap, true, rotations_file, engine);
+        backtracker.SetNogoods(nogoods.get());
+        backtracker.SetCompletions(completions.get(), completion_cells);
+        if (resume && !backtracker.Load(checkpoint)) {
+            printf("Checkpoint %s does not match this search\n", checkpoint_file.c_str());
+            return 1;
+        }
+        resume = false;
         backtracker.RegisterOnSolve(&solved_callback);
         backtracker.RegisterOnNewBest(&newbest_callback);
 
@@ -146,14 +574,18 @@ int main(int argc, char* argv[])
         long long total = 0;
         int start = (int)time(0);
         int start_absolute = start;
+        int last_checkpoint = start;
         int score = 0;
         int max_score = 0;
         printf("score: %i\n", score);
 
+        // steps are run in batches, time is checked only in between
         bool keep_going = true;
         while (keep_going) {
-            total += 1;
-            i += 1;
+            long long nodes = 0;
+            keep_going = backtracker.Run(RUN_NODES, start + 1, nodes);
+            total += nodes;
+            i += static_cast<int>(nodes);
             //if (i % 5 == 0) {
             //    Sleep(1);
             //}
@@ -170,12 +602,22 @@ int main(int argc, char* argv[])
                 printf("max_score: %i, iters: %lli (+%i) "
                     "expl: %s/%s (%s +%s)\n",
                     newbest_callback.max_score, total, i, explAbs.c_str(), explMax.c_str(), explRatio.c_str(), explAbsLast.c_str());
+                PrintNogoods(nogoods.get());
+                PrintCompletions(completions.get());
 
                 Sleep(10);
                 i = 0;
                 start = now;
             }
 
+            if (!checkpoint_file.empty() && now - last_checkpoint >= checkpoint_interval) {
+                checkpoint.Clear();
+                checkpoint.Put(seed);
+                backtracker.Save(checkpoint);
+                checkpoint.Save();
+                last_checkpoint = now;
+            }
+
             if (restarting) {
                 if ((int)time(0) - start_absolute >= restart_seconds) {
                     score = board.GetScore();
@@ -188,11 +630,16 @@ int main(int argc, char* argv[])
                     restarting = false;
                 }
             }
-
-            keep_going = backtracker.Step();
         }
 
         if (!keep_going) {
+            if (!checkpoint_file.empty()) {
+                checkpoint.Clear();
+                checkpoint.Put(seed);
+                backtracker.Save(checkpoint);
+                checkpoint.Save();
+            }
+
             printf("finished in %i sec, total iterations: %lli\n", (int)time(0) - start_absolute, total);
             std::string explAbsLast, explAbs, explMax, explRatio;
             backtracker.GetStats().GetExploredAbsLast().PrintExp(explAbsLast);
@@ -203,6 +650,8 @@ int main(int argc, char* argv[])
             printf("max_score: %i, iters: %i, "
                 "explAbsLast: %s, explRatio: %s, explMax: %s\n",
                 max_score, i, explAbsLast.c_str(), explRatio.c_str(), explMax.c_str());
+            PrintNogoods(nogoods.get());
+            PrintCompletions(completions.get());
             break;
         }
     }
@@ -0,0 +1,45 @@
+#include <cstdlib>
+#include "Args.h"
+
+using namespace edge;
+
+Args::Args(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") == 0) {
+            auto eq = arg.find('=');
+            if (eq != std::string::npos) {
+                options[arg.substr(2, eq - 2)] = arg.substr(eq + 1);
+            }
+            else {
+                options[arg.substr(2)] = "";
+            }
+        }
+        else {
+            positional.push_back(arg);
+        }
+    }
+}
+
+const std::vector<std::string>& Args::GetPositional() const
+{
+    return positional;
+}
+
+bool Args::Has(const std::string& name) const
+{
+    return options.find(name) != options.end();
+}
+
+std::string Args::Get(const std::string& name, const std::string& def) const
+{
+    auto it = options.find(name);
+    return (it != options.end()) ? it->second : def;
+}
+
+int Args::GetInt(const std::string& name, int def) const
+{
+    auto it = options.find(name);
+    return (it != options.end() && !it->second.empty()) ? atoi(it->second.c_str()) : def;
+}
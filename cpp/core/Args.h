@@ -0,0 +1,29 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace edge {
+
+// Command line split into positional arguments and --name[=value] options.
+class Args
+{
+public:
+    Args(int argc, char* argv[]);
+
+    const std::vector<std::string>& GetPositional() const;
+
+    bool Has(const std::string& name) const;
+
+    std::string Get(const std::string& name, const std::string& def = "") const;
+
+    int GetInt(const std::string& name, int def) const;
+
+private:
+    std::vector<std::string> positional;
+    std::map<std::string, std::string> options;
+
+};
+
+}
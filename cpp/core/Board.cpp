@@ -1,74 +1,61 @@
 #include <algorithm>
+#include <exception>
 #include <fstream>
 #include <memory>
 #include "Board.h"
 
 using namespace edge;
 
+// recount the whole board on every GetScore to verify the running score
+//#define SCORE_CHECK
+
+// rehash the whole board on every GetHash and GetRemainingHash to verify them
+//#define HASH_CHECK
+
 template <int FIRST, int SECOND>
-int ScoreBetween(const Board::Loc* loc) {
-    auto second = loc->neighbours[FIRST];
-    if (!loc || !loc->ref || !second || !second->ref) return 0;
+int ScoreBetween(const Board::Loc* loc, const Board::Loc* second) {
+    if (!loc->ref || !second->IsPlaced()) return 0;
     return (loc->ref->GetPattern(FIRST) == second->ref->GetPattern(SECOND)) ? 1 : 0;
 }
 
 Board::Loc::Loc() : ref(nullptr), hint(nullptr), x(0), y(0), type(Board::LocType::UNKNOWN)
 {
-    // need to be relinked
-    neighbours[0] = 0;
-    neighbours[1] = 0;
-    neighbours[2] = 0;
-    neighbours[3] = 0;
-}
-
-Board::Loc::Loc(const Loc& other) : ref(other.ref), hint(other.hint), x(other.x), y(other.y), type(other.type)
-{
-    // neighbours are ignored, it is always empty during copy/assignment, must be relinked
-    neighbours[0] = 0;
-    neighbours[1] = 0;
-    neighbours[2] = 0;
-    neighbours[3] = 0;
-}
-
-Board::Loc& Board::Loc::operator= (const Board::Loc& other)
-{
-    // neighbours are ignored, it is always empty during copy/assignment, must be relinked
-    if (this != &other)
-    {
-        ref = other.ref;
-        hint = other.hint;
-        x = other.x;
-        y = other.y;
-        type = other.type;
-
-        neighbours[0] = 0;
-        neighbours[1] = 0;
-        neighbours[2] = 0;
-        neighbours[3] = 0;
-    }
-
-    return *this;
 }
 
 Board::Board(const PuzzleDef* def)
-    : def(def)
+    : def(def), recording(false)
 {
-    state.refs.resize(def->GetPieceCount() + 1);
-    for (int id = 1; id < state.refs.size(); ++id) {
+    refs.resize(4 * (def->GetPieceCount() + 1));
+    for (int id = 1; id <= def->GetPieceCount(); ++id) {
         const auto& piece_def = def->GetPieceDef(id);
         for (int dir = 0; dir < 4; ++dir) {
-            state.refs[id][dir] = std::make_unique<PieceRef>(piece_def, dir);
+            refs[4 * id + dir] = PieceRef(piece_def, dir);
         }
     }
 
-    state.board.resize(def->GetHeight());
-    for (size_t x = 0; x < state.board.size(); ++x)
-    {
-        state.board[x].resize(def->GetWidth());
-        auto& row = state.board[x];
-        for (size_t y = 0; y < row.size(); ++y) {
-            row[y].x = static_cast<int>(x);
-            row[y].y = static_cast<int>(y);
+    state.score = 0;
+    state.hash = 0;
+    state.remaining_hash = 0;
+    for (int id = 1; id <= def->GetPieceCount(); ++id) {
+        state.remaining_hash ^= GetKey(id);
+    }
+
+    // frame holds piece 0, all of its patterns are 0 as of border
+    stride = def->GetWidth() + 2;
+    offsets[EAST] = 1;
+    offsets[SOUTH] = stride;
+    offsets[WEST] = -1;
+    offsets[NORTH] = -stride;
+    state.board.resize((def->GetHeight() + 2) * stride);
+    for (int x = -1; x <= def->GetHeight(); ++x) {
+        for (int y = -1; y <= def->GetWidth(); ++y) {
+            auto& loc = state.board[Index(x, y)];
+            loc.x = x;
+            loc.y = y;
+            if (x < 0 || x == def->GetHeight() || y < 0 || y == def->GetWidth()) {
+                loc.type = LocType::FRAME;
+                loc.ref = GetRef(0, 0);
+            }
         }
     }
 
@@ -85,7 +72,7 @@ Board::Board(const PuzzleDef* def)
     }
 
     for (auto& hint : def->GetHints()) {
-        state.board[hint.x][hint.y].hint = &hint;
+        state.board[Index(hint.x, hint.y)].hint = &hint;
     }
 
     corners.clear();
@@ -101,36 +88,35 @@ Board::Board(const PuzzleDef* def)
     corners.push_back(std::pair<int, int>(def->GetHeight() - 1, 0));
     corners.push_back(std::pair<int, int>(def->GetHeight() - 1, def->GetWidth() - 1));
 
-    state.board[0][0].type = LocType::CORNER;
-    state.board[0][def->GetWidth() - 1].type = LocType::CORNER;
-    state.board[def->GetHeight() - 1][0].type = LocType::CORNER;
-    state.board[def->GetHeight() - 1][def->GetWidth() - 1].type = LocType::CORNER;
+    state.board[Index(0, 0)].type = LocType::CORNER;
+    state.board[Index(0, def->GetWidth() - 1)].type = LocType::CORNER;
+    state.board[Index(def->GetHeight() - 1, 0)].type = LocType::CORNER;
+    state.board[Index(def->GetHeight() - 1, def->GetWidth() - 1)].type = LocType::CORNER;
 
     for (int k = 1; k < def->GetWidth() - 1; ++k) {
         top_edges.push_back(std::pair<int, int>(0, k));
         bottom_edges.push_back(std::pair<int, int>(def->GetHeight() - 1, k));
         edges.push_back(std::pair<int, int>(0, k));
         edges.push_back(std::pair<int, int>(def->GetHeight() - 1, k));
-        state.board[0][k].type = LocType::EDGE;
-        state.board[def->GetHeight() - 1][k].type = LocType::EDGE;
+        state.board[Index(0, k)].type = LocType::EDGE;
+        state.board[Index(def->GetHeight() - 1, k)].type = LocType::EDGE;
     }
     for (int k = 1; k < def->GetHeight() - 1; ++k) {
         left_edges.push_back(std::pair<int, int>(k, 0));
         right_edges.push_back(std::pair<int, int>(k, def->GetWidth() - 1));
         edges.push_back(std::pair<int, int>(k, 0));
         edges.push_back(std::pair<int, int>(k, def->GetWidth() - 1));
-        state.board[k][0].type = LocType::EDGE;
-        state.board[k][def->GetWidth() - 1].type = LocType::EDGE;
+        state.board[Index(k, 0)].type = LocType::EDGE;
+        state.board[Index(k, def->GetWidth() - 1)].type = LocType::EDGE;
     }
 
     for (int i = 1; i < def->GetHeight() - 1; ++i) {
         for (int j = 1; j < def->GetWidth() - 1; ++j) {
             inner.push_back(std::pair<int, int>(i, j));
-            state.board[i][j].type = LocType::INNER;
+            state.board[Index(i, j)].type = LocType::INNER;
         }
     }
 
-    UpdateLinks();
     UpdateIds();
 }
 
@@ -139,11 +125,11 @@ void Board::Save(const std::string& filename)
     std::ofstream file(filename);
     for (int x = 0; x < def->GetHeight(); ++x) {
         for (int y = 0; y < def->GetWidth(); ++y) {
-            if (state.board[x][y].ref) {
+            if (state.board[Index(x, y)].ref) {
                 file << x << "," 
                     << y << "," 
-                    << state.board[x][y].ref->GetId() << "," 
-                    << state.board[x][y].ref->GetDir()
+                    << state.board[Index(x, y)].ref->GetId() << "," 
+                    << state.board[Index(x, y)].ref->GetDir()
                     << std::endl;
             }
         }
@@ -171,21 +157,45 @@ Board::State Board::Backup()
 
 void Board::Restore(State& state)
 {
+    // same size, locations stay in place and pointers to them valid
     this->state = state;
-    UpdateLinks();
-    UpdateIds();
+    undo.clear();
 }
 
-void Board::UpdateLinks()
+size_t Board::Mark()
 {
-    for (int i = 0; i < def->GetHeight(); ++i) {
-        for (int j = 0; j < def->GetWidth(); ++j) {
-            state.board[i][j].neighbours[NORTH] = (i > 0) ? &state.board[i - 1][j] : nullptr;
-            state.board[i][j].neighbours[SOUTH] = (i < def->GetHeight() - 1) ? &state.board[i + 1][j] : nullptr;
-            state.board[i][j].neighbours[WEST] = (j > 0) ? &state.board[i][j - 1] : nullptr;
-            state.board[i][j].neighbours[EAST] = (j < def->GetWidth() - 1) ? &state.board[i][j + 1] : nullptr;
+    recording = true;
+    return undo.size();
+}
+
+void Board::RollbackTo(size_t mark)
+{
+    if (undo.size() <= mark) {
+        return;
+    }
+
+    // undone from the newest, score is then the one before the oldest change
+    for (size_t i = undo.size(); i-- > mark; ) {
+        Loc* loc = undo[i].loc;
+        // piece may have been moved here from elsewhere, restored there later
+        if (loc->ref && state.locations_per_id[loc->ref->GetId()] == loc) {
+            state.locations_per_id[loc->ref->GetId()] = nullptr;
+        }
+        loc->ref = undo[i].ref;
+        if (loc->ref) {
+            state.locations_per_id[loc->ref->GetId()] = loc;
         }
     }
+    state.score = undo[mark].score;
+    state.hash = undo[mark].hash;
+    state.remaining_hash = undo[mark].remaining_hash;
+    undo.resize(mark);
+}
+
+void Board::Commit()
+{
+    undo.clear();
+    recording = false;
 }
 
 void Board::UpdateIds()
@@ -195,9 +205,9 @@ void Board::UpdateIds()
 
     for (int i = 0; i < def->GetHeight(); ++i) {
         for (int j = 0; j < def->GetWidth(); ++j) {
-            if (state.board[i][j].ref)
+            if (state.board[Index(i, j)].ref)
             {
-                state.locations_per_id[state.board[i][j].ref->GetId()] = &state.board[i][j];
+                state.locations_per_id[state.board[Index(i, j)].ref->GetId()] = &state.board[Index(i, j)];
             }
         }
     }
@@ -217,32 +227,36 @@ void Board::Randomize()
     auto edges_it = edges_copy.begin();
     auto inner_it = inner_copy.begin();
 
-    state.board[0][0].ref = GetRef((corners_it++)->id, EAST);
-    state.board[0][def->GetWidth() - 1].ref = GetRef((corners_it++)->id, SOUTH);
-    state.board[def->GetHeight() - 1][0].ref = GetRef((corners_it++)->id, NORTH);
-    state.board[def->GetHeight() - 1][def->GetWidth() - 1].ref = GetRef((corners_it++)->id, WEST);
+    state.board[Index(0, 0)].ref = GetRef((corners_it++)->id, EAST);
+    state.board[Index(0, def->GetWidth() - 1)].ref = GetRef((corners_it++)->id, SOUTH);
+    state.board[Index(def->GetHeight() - 1, 0)].ref = GetRef((corners_it++)->id, NORTH);
+    state.board[Index(def->GetHeight() - 1, def->GetWidth() - 1)].ref = GetRef((corners_it++)->id, WEST);
 
     for (auto dest : top_edges) {
-        state.board[dest.first][dest.second].ref = GetRef((edges_it++)->id, EAST);
+        state.board[Index(dest.first, dest.second)].ref = GetRef((edges_it++)->id, EAST);
     }
     for (auto dest : bottom_edges) {
-        state.board[dest.first][dest.second].ref = GetRef((edges_it++)->id, WEST);
+        state.board[Index(dest.first, dest.second)].ref = GetRef((edges_it++)->id, WEST);
     }
     for (auto dest : left_edges) {
-        state.board[dest.first][dest.second].ref = GetRef((edges_it++)->id, NORTH);
+        state.board[Index(dest.first, dest.second)].ref = GetRef((edges_it++)->id, NORTH);
     }
     for (auto dest : right_edges) {
-        state.board[dest.first][dest.second].ref = GetRef((edges_it++)->id, SOUTH);
+        state.board[Index(dest.first, dest.second)].ref = GetRef((edges_it++)->id, SOUTH);
     }
     for (auto dest : inner) {
-        state.board[dest.first][dest.second].ref = GetRef((inner_it++)->id, rand() % 4);
+        state.board[Index(dest.first, dest.second)].ref = GetRef((inner_it++)->id, rand() % 4);
     }
 
+    // written directly, recorded changes do not apply anymore
+    state.score = CountScore();
+    CountHashes(state.hash, state.remaining_hash);
+    undo.clear();
     UpdateIds();
 
     for (int x = 0; x < def->GetHeight(); ++x) {
         for (int y = 0; y < def->GetWidth(); ++y) {
-            auto& loc = state.board[x][y];
+            auto& loc = state.board[Index(x, y)];
             if (loc.hint) {
                 int hint_id = loc.hint->id;
                 auto& current_hint_loc = state.locations_per_id[hint_id];
@@ -262,22 +276,22 @@ void Board::AdjustDirBorderSafe(Board::Loc* loc, int dir)
 
 void Board::AdjustDirBorder()
 {
-    AdjustDirBorderSafe(&state.board[0][0], EAST);
-    AdjustDirBorderSafe(&state.board[0][def->GetWidth() - 1], SOUTH);
-    AdjustDirBorderSafe(&state.board[def->GetHeight() - 1][0], NORTH);
-    AdjustDirBorderSafe(&state.board[def->GetHeight() - 1][def->GetWidth() - 1], WEST);
+    AdjustDirBorderSafe(&state.board[Index(0, 0)], EAST);
+    AdjustDirBorderSafe(&state.board[Index(0, def->GetWidth() - 1)], SOUTH);
+    AdjustDirBorderSafe(&state.board[Index(def->GetHeight() - 1, 0)], NORTH);
+    AdjustDirBorderSafe(&state.board[Index(def->GetHeight() - 1, def->GetWidth() - 1)], WEST);
 
     for (auto dest : top_edges) {
-        AdjustDirBorderSafe(&state.board[dest.first][dest.second],EAST);
+        AdjustDirBorderSafe(&state.board[Index(dest.first, dest.second)],EAST);
     }
     for (auto dest : bottom_edges) {
-        AdjustDirBorderSafe(&state.board[dest.first][dest.second],WEST);
+        AdjustDirBorderSafe(&state.board[Index(dest.first, dest.second)],WEST);
     }
     for (auto dest : left_edges) {
-        AdjustDirBorderSafe(&state.board[dest.first][dest.second],NORTH);
+        AdjustDirBorderSafe(&state.board[Index(dest.first, dest.second)],NORTH);
     }
     for (auto dest : right_edges) {
-        AdjustDirBorderSafe(&state.board[dest.first][dest.second],SOUTH);
+        AdjustDirBorderSafe(&state.board[Index(dest.first, dest.second)],SOUTH);
     }
 }
 
@@ -300,7 +314,7 @@ void Board::AdjustDirInner()
     while (did_change) {
         did_change = false;
         for (auto dest : inner) {
-            if (AdjustDirInner(&state.board[dest.first][dest.second]))
+            if (AdjustDirInner(&state.board[Index(dest.first, dest.second)]))
             {
                 did_change = true;
             }
@@ -313,12 +327,12 @@ void Board::PutPiece(int id, int x, int y, int dir)
 {
     if (state.locations_per_id[id]) {
         // alrady placed, swap positions
-        SwapLocations(state.locations_per_id[id], &state.board[x][y]);
-        ChangeDir(&state.board[x][y], dir);
+        SwapLocations(state.locations_per_id[id], &state.board[Index(x, y)]);
+        ChangeDir(&state.board[Index(x, y)], dir);
     } else {
-        state.board[x][y].ref = GetRef(id, dir);
+        SetRef(&state.board[Index(x, y)], GetRef(id, dir));
     }
-    state.locations_per_id[id] = &state.board[x][y];
+    state.locations_per_id[id] = &state.board[Index(x, y)];
 }
 
 void Board::PutPiece(Board::Loc* loc, PieceRef* ref)
@@ -329,7 +343,7 @@ void Board::PutPiece(Board::Loc* loc, PieceRef* ref)
         ChangeDir(loc, ref->GetDir());
     }
     else {
-        loc->ref = ref;
+        SetRef(loc, ref);
     }
     state.locations_per_id[ref->GetId()] = loc;
 }
@@ -337,7 +351,7 @@ void Board::PutPiece(Board::Loc* loc, PieceRef* ref)
 void Board::RemovePiece(Board::Loc* loc)
 {
     state.locations_per_id[loc->ref->GetId()] = nullptr;
-    loc->ref = nullptr;
+    SetRef(loc, nullptr);
 }
 
 const PuzzleDef* Board::GetPuzzleDef() const
@@ -346,16 +360,26 @@ const PuzzleDef* Board::GetPuzzleDef() const
 }
 
 int Board::GetScore() const
+{
+#ifdef SCORE_CHECK
+    if (state.score != CountScore()) {
+        throw std::exception("Running score does not match the board!");
+    }
+#endif
+    return state.score;
+}
+
+int Board::CountScore() const
 {
     int score = 0;
     for (int x = 0; x < def->GetHeight(); ++x) {
         for (int y = 0; y < def->GetWidth() - 1; ++y) {
-            score += ScoreBetween<EAST, WEST>(&state.board[x][y]);
+            score += ScoreBetween<EAST, WEST>(&state.board[Index(x, y)], &state.board[Index(x, y + 1)]);
         }
     }
     for (int x = 0; x < def->GetHeight() - 1; ++x) {
         for (int y = 0; y < def->GetWidth(); ++y) {
-            score += ScoreBetween<SOUTH, NORTH>(&state.board[x][y]);
+            score += ScoreBetween<SOUTH, NORTH>(&state.board[Index(x, y)], &state.board[Index(x + 1, y)]);
         }
     }
     return score;
@@ -364,13 +388,62 @@ int Board::GetScore() const
 int Board::GetScore(Loc* loc)
 {
     int score = 0;
-    score += ScoreBetween<EAST, WEST>(loc);
-    score += ScoreBetween<WEST, EAST>(loc);
-    score += ScoreBetween<SOUTH, NORTH>(loc);
-    score += ScoreBetween<NORTH, SOUTH>(loc);
+    score += ScoreBetween<EAST, WEST>(loc, GetNeighbour(loc, EAST));
+    score += ScoreBetween<WEST, EAST>(loc, GetNeighbour(loc, WEST));
+    score += ScoreBetween<SOUTH, NORTH>(loc, GetNeighbour(loc, SOUTH));
+    score += ScoreBetween<NORTH, SOUTH>(loc, GetNeighbour(loc, NORTH));
     return score;
 }
 
+int Board::GetScore(Loc* loc, PieceRef* ref) const
+{
+    uint32_t placed;
+    uint32_t facing = GetFacing(loc, placed);
+    return CountMatches(ref->GetPatterns(), facing, placed);
+}
+
+uint64_t Board::GetHash() const
+{
+#ifdef HASH_CHECK
+    uint64_t hash, remaining_hash;
+    CountHashes(hash, remaining_hash);
+    if (state.hash != hash) {
+        throw std::exception("Running hash does not match the board!");
+    }
+#endif
+    return state.hash;
+}
+
+uint64_t Board::GetRemainingHash() const
+{
+#ifdef HASH_CHECK
+    uint64_t hash, remaining_hash;
+    CountHashes(hash, remaining_hash);
+    if (state.remaining_hash != remaining_hash) {
+        throw std::exception("Running hash of remaining pieces does not match the board!");
+    }
+#endif
+    return state.remaining_hash;
+}
+
+void Board::CountHashes(uint64_t& hash, uint64_t& remaining_hash) const
+{
+    hash = 0;
+    remaining_hash = 0;
+    for (int id = 1; id <= def->GetPieceCount(); ++id) {
+        remaining_hash ^= GetKey(id);
+    }
+    for (int x = 0; x < def->GetHeight(); ++x) {
+        for (int y = 0; y < def->GetWidth(); ++y) {
+            const Loc* loc = &state.board[Index(x, y)];
+            if (loc->ref) {
+                hash ^= GetKey(loc, loc->ref);
+                remaining_hash ^= GetKey(loc->ref->GetId());
+            }
+        }
+    }
+}
+
 std::vector< std::pair<int, int> >& Board::GetCornersCoords()
 {
     return corners;
@@ -399,23 +472,14 @@ void Board::SwapLocations(Board::Loc* loc1,
     auto id1 = (loc1->ref) ? loc1->ref->GetId() : 0;
     auto id2 = (loc2->ref) ? loc2->ref->GetId() : 0;
     std::swap(locs[id1], locs[id2]);
-    std::swap(loc1->ref, loc2->ref);
+    PieceRef* ref1 = loc1->ref;
+    SetRef(loc1, loc2->ref);
+    SetRef(loc2, ref1);
 }
 
 Board::Loc* Board::GetLocation(int x, int y)
 {
-    return &state.board[x][y];
-}
-
-PieceRef* Board::GetRef(int id, int dir)
-{
-    return state.refs[id][dir].get();
-}
-
-void Board::ChangeDir(Board::Loc* loc, int dir)
-{
-    int id = loc->ref->GetId();
-    loc->ref = GetRef(id, dir);
+    return &state.board[Index(x, y)];
 }
 
 bool Board::AdjustDirInner(Loc* loc)
@@ -424,12 +488,15 @@ bool Board::AdjustDirInner(Loc* loc)
         return false;
     }
 
+    // try rotations against neighbours without changing the board
+    uint32_t placed;
+    uint32_t facing = GetFacing(loc, placed);
+    int id = loc->ref->GetId();
     int start_dir = loc->ref->GetDir();
     int best_dir = 0, best_score = 0, dir_offset = 0;
     for (dir_offset = 0; dir_offset < 4; ++dir_offset) {
         int dir = (start_dir + dir_offset) % 4;
-        ChangeDir(loc,dir);
-        int score = GetScore(loc);
+        int score = CountMatches(GetRef(id, dir)->GetPatterns(), facing, placed);
         if (score > best_score) {
             best_score = score;
             best_dir = dir;
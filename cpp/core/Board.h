@@ -14,40 +14,65 @@ public:
         UNKNOWN,
         CORNER,
         EDGE,
-        INNER
+        INNER,
+        FRAME // outside of the puzzle
     };
 
     struct Loc
     {
         PieceRef* ref;
-        Loc* neighbours[4];
         const HintDef* hint;
         int x, y;
         LocType type;
 
-
         Loc();
-        Loc(const Loc& other);
-        Loc& operator= (const Loc& other);
+
+        // frame locations hold piece with all patterns 0, which is not placed
+        bool IsPlaced() const
+        {
+            return ref && type != LocType::FRAME;
+        }
     };
 
     struct State {
-        std::vector< std::vector<
-            Loc > > board;
+        // row-major including one location wide frame around the puzzle, so
+        // that every location has all neighbours at constant offsets
+        std::vector< Loc > board;
         std::vector< Loc* > locations_per_id;
-        std::vector< std::array<std::shared_ptr<PieceRef>, 4> > refs; // pool owning all pieces references
+        int score; // matching edges, kept up to date on every change
+        uint64_t hash; // of placed pieces, see GetHash
+        uint64_t remaining_hash; // of pieces not placed, see GetRemainingHash
     };
 
     Board(const PuzzleDef* def);
 
+    // locations point into own pool of pieces
+    Board(const Board& other) = delete;
+
+    Board& operator=(const Board& other) = delete;
+
     void Save(const std::string& filename);
 
     void Load(const std::string& filename);
 
+    // full copy of the state, to keep it aside for saving, changes made during
+    // search are undone by Mark and RollbackTo instead
     Board::State Backup();
 
+    // replaces the whole state, recorded changes are dropped
     void Restore(Board::State& state);
 
+    // starts recording changes of pieces (if not recording yet) and returns
+    // current position in the record, marks can be nested
+    size_t Mark();
+
+    // reverts changes recorded since given mark, in time proportional to
+    // their count
+    void RollbackTo(size_t mark);
+
+    // accepts all recorded changes and stops recording
+    void Commit();
+
     void Randomize();
 
     void AdjustDirBorder();
@@ -64,10 +89,24 @@ public:
 
     const PuzzleDef* GetPuzzleDef() const;
 
+    // number of matching edges between placed pieces
     int GetScore() const;
 
+    // number of matching edges of given location
     int GetScore(Loc* loc);
 
+    // number of matching edges given piece would have at the location, with
+    // neighbours as they are
+    int GetScore(Loc* loc, PieceRef* ref) const;
+
+    // Zobrist hash of placed pieces with their locations and rotations, keys
+    // do not depend on the run, so the hash is comparable across processes
+    // solving the same puzzle
+    uint64_t GetHash() const;
+
+    // Zobrist hash of the set of pieces not placed on the board
+    uint64_t GetRemainingHash() const;
+
     std::vector< std::pair<int, int> >& GetCornersCoords();
 
     std::vector< std::pair<int, int> >& GetEdgesCoords();
@@ -81,16 +120,110 @@ public:
 
     Loc* GetLocation(int x, int y);
 
-    PieceRef* GetRef(int id, int dir);
+    // neighbouring location in given direction, frame location at the border
+    Loc* GetNeighbour(Loc* loc, int dir) const
+    {
+        return loc + offsets[dir];
+    }
+
+    // pattern of neighbour in given direction facing the location, 0 at the
+    // border, empty_color if there is no piece
+    int GetNeighbourPattern(const Loc* loc, int dir, int empty_color) const
+    {
+        const Loc* neighbour = loc + offsets[dir];
+        return neighbour->ref ? neighbour->ref->GetPattern((dir + 2) % 4) : empty_color;
+    }
+
+    PieceRef* GetRef(int id, int dir)
+    {
+        return &refs[4 * id + dir];
+    }
 
-    void ChangeDir(Board::Loc* loc, int dir);
+    void ChangeDir(Board::Loc* loc, int dir)
+    {
+        SetRef(loc, GetRef(loc->ref->GetId(), dir));
+    }
 
 private:
 
-    void UpdateLinks();
+    int Index(int x, int y) const
+    {
+        return (x + 1) * stride + y + 1;
+    }
 
     void UpdateIds();
 
+    // all changes of pieces on the board go through here, in header as it
+    // runs on every placement of backtrackers and every move of swapper
+    void SetRef(Loc* loc, PieceRef* ref)
+    {
+        if (loc->ref == ref) {
+            return;
+        }
+        if (recording) {
+            undo.push_back(Change{ loc, loc->ref, state.score, state.hash, state.remaining_hash });
+        }
+
+        // only edges of this location change
+        uint32_t placed;
+        uint32_t facing = GetFacing(loc, placed);
+        if (loc->ref) {
+            state.score -= CountMatches(loc->ref->GetPatterns(), facing, placed);
+            state.hash ^= GetKey(loc, loc->ref);
+            state.remaining_hash ^= GetKey(loc->ref->GetId());
+        }
+        loc->ref = ref;
+        if (ref) {
+            state.score += CountMatches(ref->GetPatterns(), facing, placed);
+            state.hash ^= GetKey(loc, ref);
+            state.remaining_hash ^= GetKey(ref->GetId());
+        }
+    }
+
+    // Zobrist key of piece in given rotation at the location, computed instead
+    // of drawn into a table of locations * pieces * rotations
+    uint64_t GetKey(const Loc* loc, const PieceRef* ref) const
+    {
+        return MixHash((static_cast<uint64_t>(loc - &state.board[0]) << 32) | static_cast<uint64_t>(ref - &refs[0]));
+    }
+
+    // key of piece in the set of remaining ones, location index never gets
+    // this high for the keys above
+    static uint64_t GetKey(int id)
+    {
+        return MixHash(0xffffffff00000000ull | static_cast<uint64_t>(id));
+    }
+
+    // patterns of neighbours facing the location, packed the same way as
+    // patterns of piece to compare all at once, placed has high bit set in
+    // bytes of placed neighbours
+    uint32_t GetFacing(const Loc* loc, uint32_t& placed) const
+    {
+        uint32_t facing = 0;
+        placed = 0;
+        for (int dir = 0; dir < 4; ++dir) {
+            const Loc* neighbour = loc + offsets[dir];
+            if (neighbour->IsPlaced()) {
+                facing |= static_cast<uint32_t>(neighbour->ref->GetPattern((dir + 2) % 4)) << (8 * dir);
+                placed |= 0x80u << (8 * dir);
+            }
+        }
+        return facing;
+    }
+
+    // number of equal bytes of packed patterns, counting only bytes with high
+    // bit set in mask, without branching on the patterns themselves
+    static int CountMatches(uint32_t patterns, uint32_t facing, uint32_t mask)
+    {
+        uint32_t diff = patterns ^ facing;
+        uint32_t nonzero = ((diff & 0x7f7f7f7fu) + 0x7f7f7f7fu) | diff;
+        return static_cast<int>((((~nonzero & mask) >> 7) * 0x01010101u) >> 24);
+    }
+
+    int CountScore() const;
+
+    void CountHashes(uint64_t& hash, uint64_t& remaining_hash) const;
+
     bool AdjustDirInner(Loc* loc);
 
     void AdjustDirBorderSafe(Loc* loc, int dir);
@@ -99,6 +232,18 @@ private:
 
     const PuzzleDef* def;
     Board::State state;
+    std::vector< PieceRef > refs; // all pieces in all rotations, by id * 4 + dir, id 0 is the frame
+    int stride; // of the board rows
+    int offsets[4]; // of neighbours by direction
+
+    struct Change {
+        Loc* loc;
+        PieceRef* ref; // before the change
+        int score; // before the change
+        uint64_t hash, remaining_hash; // before the change
+    };
+    std::vector< Change > undo; // changes since the first mark
+    bool recording;
 
     // fast access piece indices
     std::vector< int > corners_ids;
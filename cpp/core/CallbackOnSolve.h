@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Board.h"
+
+namespace edge {
+
+namespace backtracker {
+
+class CallbackOnSolve {
+public:
+    virtual void Call(Board& board) = 0;
+
+};
+
+}
+
+}
@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <set>
+#include "CandidateBitsets.h"
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+using namespace edge::backtracker;
+
+static inline int PopCount(uint64_t val)
+{
+#ifdef _MSC_VER
+    return static_cast<int>(__popcnt64(val));
+#else
+    return __builtin_popcountll(val);
+#endif
+}
+
+static inline int HighestBit(uint64_t val)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, val);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(val);
+#endif
+}
+
+void CandidateBitsets::Init(Board& board, const std::map<int, int>& rotations)
+{
+    auto def = board.GetPuzzleDef();
+
+    // same colour alphabet as CandidateTable, border 0 first, ANY_COLOR last
+    std::set<int> colors(def->GetEdgeColors());
+    colors.insert(def->GetInnerColors().begin(), def->GetInnerColors().end());
+    colors.erase(0);
+    std::fill(std::begin(compact), std::end(compact), 0);
+    int index = 1;
+    for (auto color : colors) {
+        compact[color] = index++;
+    }
+    compact[ANY_COLOR] = index;
+    radix = index + 1;
+
+    int bits = 4 * def->GetPieceCount();
+    int block_bits = 64 * BLOCK_WORDS;
+    words = ((bits + block_bits - 1) / block_bits) * BLOCK_WORDS;
+
+    // pieces are assigned to slots in random order, so that the highest bit
+    // first selection gives this particular run bit of randomness
+    std::vector< int > ids;
+    for (auto& piece : def->GetAll()) {
+        ids.push_back(piece.first);
+    }
+    std::random_shuffle(ids.begin(), ids.end());
+
+    piece_slot.assign(def->GetPieceCount() + 1, 0);
+    refs.assign(words * 64, nullptr);
+    masks.assign(4 * radix * words, 0);
+    available.assign(words, 0);
+    for (size_t slot = 0; slot < ids.size(); ++slot) {
+        int id = ids[slot];
+        piece_slot[id] = static_cast<int>(slot) * 4;
+        for (int dir = 0; dir < 4; ++dir) {
+            auto it = rotations.find(id);
+            if (!rotations.empty() && ((it != rotations.end()) ? it->second : 0) != dir) {
+                continue;
+            }
+            int bit = piece_slot[id] + dir;
+            auto ref = board.GetRef(id, dir);
+            refs[bit] = ref;
+            available[bit / 64] |= 1ull << (bit % 64);
+            for (int side = 0; side < 4; ++side) {
+                int pattern = ref->GetPattern(side);
+                masks[(side * radix + compact[pattern]) * words + bit / 64] |= 1ull << (bit % 64);
+                if (pattern != 0) {
+                    masks[(side * radix + compact[ANY_COLOR]) * words + bit / 64] |= 1ull << (bit % 64);
+                }
+            }
+        }
+    }
+}
+
+void CandidateBitsets::Place(const PieceRef* ref)
+{
+    int bit = piece_slot[ref->GetId()];
+    available[bit / 64] &= ~(0xFull << (bit % 64));
+}
+
+void CandidateBitsets::Unplace(const PieceRef* ref)
+{
+    int bit = piece_slot[ref->GetId()];
+    for (int dir = 0; dir < 4; ++dir) {
+        if (refs[bit + dir]) {
+            available[(bit + dir) / 64] |= 1ull << ((bit + dir) % 64);
+        }
+    }
+}
+
+int CandidateBitsets::Match(int east, int south, int west, int north, uint64_t* out) const
+{
+    const uint64_t* e = Mask(EAST, east);
+    const uint64_t* s = Mask(SOUTH, south);
+    const uint64_t* w = Mask(WEST, west);
+    const uint64_t* n = Mask(NORTH, north);
+    const uint64_t* a = available.data();
+
+    int count = 0;
+    for (int i = 0; i < words; i += BLOCK_WORDS) {
+#ifdef __AVX2__
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        v = _mm256_and_si256(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(e + i)));
+        v = _mm256_and_si256(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i)));
+        v = _mm256_and_si256(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + i)));
+        v = _mm256_and_si256(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(n + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), v);
+#else
+        for (int k = i; k < i + BLOCK_WORDS; ++k) {
+            out[k] = a[k] & e[k] & s[k] & w[k] & n[k];
+        }
+#endif
+        for (int k = i; k < i + BLOCK_WORDS; ++k) {
+            count += PopCount(out[k]);
+        }
+    }
+    return count;
+}
+
+bool CandidateBitsets::Any(int east, int south, int west, int north) const
+{
+    const uint64_t* e = Mask(EAST, east);
+    const uint64_t* s = Mask(SOUTH, south);
+    const uint64_t* w = Mask(WEST, west);
+    const uint64_t* n = Mask(NORTH, north);
+    const uint64_t* a = available.data();
+
+    for (int i = 0; i < words; i += BLOCK_WORDS) {
+#ifdef __AVX2__
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        v = _mm256_and_si256(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(e + i)));
+        v = _mm256_and_si256(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i)));
+        v = _mm256_and_si256(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w + i)));
+        v = _mm256_and_si256(v, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(n + i)));
+        if (!_mm256_testz_si256(v, v)) {
+            return true;
+        }
+#else
+        uint64_t any = 0;
+        for (int k = i; k < i + BLOCK_WORDS; ++k) {
+            any |= a[k] & e[k] & s[k] & w[k] & n[k];
+        }
+        if (any) {
+            return true;
+        }
+#endif
+    }
+    return false;
+}
+
+bool CandidateBitsets::Clear(uint64_t* bits, const PieceRef* ref) const
+{
+    int bit = piece_slot[ref->GetId()] + ref->GetDir();
+    uint64_t mask = 1ull << (bit % 64);
+    bool was_set = (bits[bit / 64] & mask) != 0;
+    bits[bit / 64] &= ~mask;
+    return was_set;
+}
+
+int CandidateBitsets::Prev(const uint64_t* bits, int before) const
+{
+    if (before < 0) {
+        before = words * 64;
+    }
+    if (before == 0) {
+        return -1;
+    }
+
+    int word = (before - 1) / 64;
+    int offset = (before - 1) % 64;
+    uint64_t val = bits[word] & (offset == 63 ? ~0ull : ((1ull << (offset + 1)) - 1));
+    while (!val) {
+        if (--word < 0) {
+            return -1;
+        }
+        val = bits[word];
+    }
+    return word * 64 + HighestBit(val);
+}
+
+edge::PieceRef* CandidateBitsets::GetRef(int bit) const
+{
+    return refs[bit];
+}
+
+int CandidateBitsets::GetWords() const
+{
+    return words;
+}
+
+const uint64_t* CandidateBitsets::Mask(int side, int color) const
+{
+    return masks.data() + (side * radix + compact[color]) * words;
+}
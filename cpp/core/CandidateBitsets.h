@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "Board.h"
+#include "CandidateTable.h"
+
+namespace edge {
+
+namespace backtracker {
+
+enum class CandidateEngine {
+    TABLE = 0,
+    BITSET = 1
+};
+
+// Alternative to CandidateTable, keeps one bitset of piece rotations per
+// (side, colour) plus bitset of still available rotations. Candidates for a
+// location are AND of up to four side bitsets, processed in 256 bit blocks.
+class CandidateBitsets
+{
+public:
+    static const int BLOCK_WORDS = 4; // 4 x 64 = 256 bits
+
+    // rotations - allowed rotation per piece id, empty to allow all
+    void Init(Board& board, const std::map<int, int>& rotations);
+
+    // marks all rotations of given piece as (un)available
+    void Place(const PieceRef* ref);
+
+    void Unplace(const PieceRef* ref);
+
+    // stores available rotations matching patterns into out (GetWords long),
+    // returns their count
+    int Match(int east, int south, int west, int north, uint64_t* out) const;
+
+    // whether at least one available rotation matches patterns
+    bool Any(int east, int south, int west, int north) const;
+
+    // clears given rotation from bitset obtained by Match, returns true if it was set
+    bool Clear(uint64_t* bits, const PieceRef* ref) const;
+
+    // highest set bit lower than before (-1 for start), -1 if none
+    int Prev(const uint64_t* bits, int before) const;
+
+    PieceRef* GetRef(int bit) const;
+
+    int GetWords() const;
+
+private:
+    const uint64_t* Mask(int side, int color) const;
+
+    int radix;
+    int words;
+    int compact[ANY_COLOR + 1];
+    std::vector< int > piece_slot; // piece id -> first bit of its rotations
+    std::vector< PieceRef* > refs; // bit -> rotation
+    std::vector< uint64_t > masks; // [side][colour][words]
+    std::vector< uint64_t > available;
+
+};
+
+}
+
+}
@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <set>
+#include "CandidateTable.h"
+
+using namespace edge::backtracker;
+
+void CandidateTable::Init(const PuzzleDef* def)
+{
+    // border colour always gets index 0, rest follows in ascending order
+    std::set<int> colors(def->GetEdgeColors());
+    colors.insert(def->GetInnerColors().begin(), def->GetInnerColors().end());
+    colors.erase(0);
+
+    std::fill(std::begin(compact), std::end(compact), 0);
+    int index = 1;
+    for (auto color : colors) {
+        compact[color] = index++;
+    }
+    compact[ANY_COLOR] = index;
+    radix = index + 1;
+
+    offsets.clear();
+    pieces.clear();
+    pending.clear();
+}
+
+void CandidateTable::Add(PieceRef* ref)
+{
+    for (int mask = 0; mask < 16; ++mask) {
+        int patterns[4];
+        bool valid = true;
+        for (int side = 0; side < 4; ++side) {
+            patterns[side] = ref->GetPattern(side);
+            if (mask & (1 << side)) {
+                // border side never faces an empty neighbour
+                valid = valid && patterns[side] != 0;
+                patterns[side] = ANY_COLOR;
+            }
+        }
+        if (valid) {
+            pending.push_back(std::make_pair(
+                Encode(patterns[EAST], patterns[SOUTH], patterns[WEST], patterns[NORTH]), ref));
+        }
+    }
+}
+
+void CandidateTable::Build()
+{
+    // counting sort, stable so insertion order is kept within each bucket
+    offsets.assign(GetKeyCount() + 1, 0);
+    for (auto& item : pending) {
+        offsets[item.first + 1] += 1;
+    }
+    for (size_t key = 1; key < offsets.size(); ++key) {
+        offsets[key] += offsets[key - 1];
+    }
+
+    std::vector< int > fill(offsets.begin(), offsets.end() - 1);
+    pieces.resize(pending.size());
+    for (auto& item : pending) {
+        pieces[fill[item.first]++] = item.second;
+    }
+    pending.clear();
+    pending.shrink_to_fit();
+
+    // shuffle buckets to give this particular run bit of randomness
+    for (int key = 0; key < GetKeyCount(); ++key) {
+        std::random_shuffle(pieces.begin() + offsets[key], pieces.begin() + offsets[key + 1]);
+    }
+}
+
+int CandidateTable::GetColorCount() const
+{
+    return radix - 1;
+}
+
+int CandidateTable::GetKeyCount() const
+{
+    return radix * radix * radix * radix;
+}
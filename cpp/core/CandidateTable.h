@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include "PuzzleDef.h"
+
+namespace edge {
+
+namespace backtracker {
+
+const int ANY_COLOR = 0xFF;
+
+// Dense lookup of piece rotations matching given side patterns, where any
+// side may be ANY_COLOR (empty neighbour). Colours are compacted to a small
+// alphabet so that every combination of four sides maps directly to an index,
+// candidates are then stored packed in one array (CSR like offsets + pieces).
+class CandidateTable
+{
+public:
+    struct Range {
+        PieceRef* const* first;
+        PieceRef* const* last;
+
+        PieceRef* const* begin() const { return first; }
+        PieceRef* const* end() const { return last; }
+        int size() const { return static_cast<int>(last - first); }
+    };
+
+    void Init(const PuzzleDef* def);
+
+    // registers rotation for all combinations of its non-border sides
+    // replaced by ANY_COLOR, must be followed by Build
+    void Add(PieceRef* ref);
+
+    void Build();
+
+    int Encode(int east, int south, int west, int north) const
+    {
+        return ((compact[east] * radix + compact[south]) * radix + compact[west]) * radix + compact[north];
+    }
+
+    Range Get(int key) const
+    {
+        return Range{ pieces.data() + offsets[key], pieces.data() + offsets[key + 1] };
+    }
+
+    int GetColorCount() const;
+
+    int GetKeyCount() const;
+
+private:
+    int radix;
+    int compact[ANY_COLOR + 1];
+    std::vector< int > offsets;
+    std::vector< PieceRef* > pieces;
+    std::vector< std::pair<int, PieceRef*> > pending;
+
+};
+
+}
+
+}
@@ -0,0 +1,170 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include "Checkpoint.h"
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace edge::backtracker;
+
+// writes whole file and waits until it is on the disk, so that the rename
+// following it never exposes empty or truncated file after power loss
+static bool WriteSynced(const std::string& filename, const std::vector<uint8_t>& data)
+{
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(filename.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    DWORD written = 0;
+    bool ok = WriteFile(handle, data.data(), static_cast<DWORD>(data.size()), &written, nullptr) &&
+        written == data.size() && FlushFileBuffers(handle);
+    return CloseHandle(handle) && ok;
+#else
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t written = write(fd, data.data() + done, data.size() - done);
+        if (written <= 0) {
+            close(fd);
+            return false;
+        }
+        done += static_cast<size_t>(written);
+    }
+    bool ok = fsync(fd) == 0;
+    return close(fd) == 0 && ok;
+#endif
+}
+
+// replaces target by source, also waits for the rename to reach the disk
+static bool Replace(const std::string& source, const std::string& target)
+{
+#ifdef _WIN32
+    return MoveFileExA(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (std::rename(source.c_str(), target.c_str()) != 0) {
+        return false;
+    }
+    size_t slash = target.find_last_of('/');
+    std::string dir = (slash == std::string::npos) ? "." : target.substr(0, slash + 1);
+    int fd = open(dir.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    return true;
+#endif
+}
+
+Checkpoint::Checkpoint(const std::string& filename)
+    : filename(filename), pos(0), valid(true)
+{
+}
+
+Checkpoint::~Checkpoint()
+{
+    Wait();
+}
+
+void Checkpoint::Clear()
+{
+    data.clear();
+    pos = 0;
+    valid = true;
+}
+
+void Checkpoint::Put(int64_t val)
+{
+    // little endian regardless of platform
+    for (int i = 0; i < 8; ++i) {
+        data.push_back(static_cast<uint8_t>(static_cast<uint64_t>(val) >> (8 * i)));
+    }
+}
+
+void Checkpoint::Put(mpz_srcptr val)
+{
+    // only non-negative values are stored
+    size_t count = (mpz_sizeinbase(val, 2) + 7) / 8;
+    size_t start = data.size();
+    data.resize(start + 8 + count);
+    size_t written = 0;
+    mpz_export(data.data() + start + 8, &written, -1, 1, -1, 0, val);
+    data.resize(start + 8 + written);
+    for (int i = 0; i < 8; ++i) {
+        data[start + i] = static_cast<uint8_t>(static_cast<uint64_t>(written) >> (8 * i));
+    }
+}
+
+void Checkpoint::Save()
+{
+    Wait();
+    storing.swap(data);
+    data.clear();
+    writer = std::thread([this]() {
+        // previous checkpoint is replaced only by complete new one
+        std::string tmp = filename + ".tmp";
+        if (!WriteSynced(tmp, storing)) {
+            printf("Unable to store checkpoint %s\n", tmp.c_str());
+            return;
+        }
+        if (!Replace(tmp, filename)) {
+            printf("Unable to replace checkpoint %s by %s\n", filename.c_str(), tmp.c_str());
+        }
+    });
+}
+
+bool Checkpoint::Load()
+{
+    Wait();
+    Clear();
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !data.empty();
+}
+
+int64_t Checkpoint::GetInt()
+{
+    if (pos + 8 > data.size()) {
+        valid = false;
+        return 0;
+    }
+    uint64_t val = 0;
+    for (int i = 0; i < 8; ++i) {
+        val |= static_cast<uint64_t>(data[pos++]) << (8 * i);
+    }
+    return static_cast<int64_t>(val);
+}
+
+void Checkpoint::Get(mpz_ptr val)
+{
+    int64_t count = GetInt();
+    if (!valid || count < 0 || pos + count > data.size()) {
+        valid = false;
+        mpz_set_ui(val, 0);
+        return;
+    }
+    mpz_import(val, static_cast<size_t>(count), -1, 1, -1, 0, data.data() + pos);
+    pos += static_cast<size_t>(count);
+}
+
+bool Checkpoint::IsValid() const
+{
+    return valid;
+}
+
+void Checkpoint::Wait()
+{
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include <gmp.h>
+
+namespace edge {
+
+namespace backtracker {
+
+// Binary snapshot of search state. Values are appended to (or read from)
+// memory buffer, which is then stored on background thread to temporary file
+// and renamed over the previous one, so that the search only waits for taking
+// the snapshot and a crash never leaves half written checkpoint behind.
+class Checkpoint {
+public:
+    Checkpoint(const std::string& filename);
+
+    // waits for pending store
+    ~Checkpoint();
+
+    Checkpoint(const Checkpoint& other) = delete;
+
+    Checkpoint& operator=(const Checkpoint& other) = delete;
+
+    // starts new snapshot
+    void Clear();
+
+    void Put(int64_t val);
+
+    void Put(mpz_srcptr val);
+
+    // stores snapshot taken since Clear
+    void Save();
+
+    // reads last stored snapshot, returns false if there is none
+    bool Load();
+
+    int64_t GetInt();
+
+    void Get(mpz_ptr val);
+
+    // false if more values were read than stored
+    bool IsValid() const;
+
+private:
+    void Wait();
+
+    std::string filename;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> storing; // snapshot owned by writer thread
+    size_t pos;
+    bool valid;
+    std::thread writer;
+
+};
+
+}
+
+}
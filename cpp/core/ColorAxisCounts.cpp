@@ -1,63 +1,163 @@
 #include <algorithm>
+#include <cstdlib>
+#include <exception>
 #include "ColorAxisCounts.h"
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 using namespace edge::backtracker;
 
-#define ABS(x) ((x < 0) ? (-x) : (x))
-
 void ColorAxisCounts::Init(const PuzzleDef* def)
 {
+    std::fill(compact, compact + 256, 0);
+    std::fill(colors_horizontal, colors_horizontal + MAX_COLORS, 0);
+    std::fill(colors_vertical, colors_vertical + MAX_COLORS, 0);
+    std::fill(colors_available, colors_available + MAX_COLORS, 0);
+    std::fill(colors_open, colors_open + MAX_COLORS, 0);
+
+    // border is always colour 0, even when no piece has it
+    bool used[256] = { true };
+    for (auto& piece : def->GetAll()) {
+        for (int dir = 0; dir < 4; ++dir) {
+            used[piece.second.patterns[dir]] = true;
+        }
+    }
+
+    int count = 0;
+    for (int pattern = 0; pattern < 256; ++pattern) {
+        if (used[pattern]) {
+            if (count == MAX_COLORS) {
+                throw std::exception("Too many colours for ColorAxisCounts");
+            }
+            compact[pattern] = static_cast<uint8_t>(count++);
+        }
+    }
+    blocks = (count + BLOCK - 1) / BLOCK;
+
     for (auto& piece : def->GetAll()) {
-        InitColor(piece.second.patterns[0]);
-        InitColor(piece.second.patterns[1]);
-        InitColor(piece.second.patterns[2]);
-        InitColor(piece.second.patterns[3]);
+        for (int dir = 0; dir < 4; ++dir) {
+            colors_available[compact[piece.second.patterns[dir]]] += 1;
+        }
+    }
+}
+
+void ColorAxisCounts::Init(Board& board)
+{
+    auto def = board.GetPuzzleDef();
+    Init(def);
+    for (int x = 0; x < def->GetHeight(); ++x) {
+        for (int y = 0; y < def->GetWidth(); ++y) {
+            auto loc = board.GetLocation(x, y);
+            if (loc->ref) {
+                Place(loc->ref->GetPattern(0), loc->ref->GetPattern(1),
+                    loc->ref->GetPattern(2), loc->ref->GetPattern(3));
+                continue;
+            }
+            for (int dir = 0; dir < 4; ++dir) {
+                auto neighbour = board.GetNeighbour(loc, dir);
+                if (neighbour->ref) {
+                    Open(neighbour->ref->GetPattern((dir + 2) % 4), 1);
+                }
+            }
+        }
     }
 }
 
 void ColorAxisCounts::Place(int k0, int k1, int k2, int k3)
 {
-    colors_horizontal[k0] += 1;
-    colors_horizontal[k2] -= 1;
-    colors_vertical[k1] += 1;
-    colors_vertical[k3] -= 1;
-    colors_available[k0] -= 1;
-    colors_available[k1] -= 1;
-    colors_available[k2] -= 1;
-    colors_available[k3] -= 1;
+    colors_horizontal[compact[k0]] += 1;
+    colors_horizontal[compact[k2]] -= 1;
+    colors_vertical[compact[k1]] += 1;
+    colors_vertical[compact[k3]] -= 1;
+    colors_available[compact[k0]] -= 1;
+    colors_available[compact[k1]] -= 1;
+    colors_available[compact[k2]] -= 1;
+    colors_available[compact[k3]] -= 1;
 }
 
 void ColorAxisCounts::Unplace(int k0, int k1, int k2, int k3)
 {
-    colors_available[k0] += 1;
-    colors_available[k1] += 1;
-    colors_available[k2] += 1;
-    colors_available[k3] += 1;
-    colors_horizontal[k0] -= 1;
-    colors_horizontal[k2] += 1;
-    colors_vertical[k1] -= 1;
-    colors_vertical[k3] += 1;
+    colors_available[compact[k0]] += 1;
+    colors_available[compact[k1]] += 1;
+    colors_available[compact[k2]] += 1;
+    colors_available[compact[k3]] += 1;
+    colors_horizontal[compact[k0]] -= 1;
+    colors_horizontal[compact[k2]] += 1;
+    colors_vertical[compact[k1]] -= 1;
+    colors_vertical[compact[k3]] += 1;
+}
+
+void ColorAxisCounts::Place(const Board& board, Board::Loc* loc)
+{
+    auto ref = loc->ref;
+    Place(ref->GetPattern(0), ref->GetPattern(1), ref->GetPattern(2), ref->GetPattern(3));
+    for (int dir = 0; dir < 4; ++dir) {
+        auto neighbour = board.GetNeighbour(loc, dir);
+        if (neighbour->ref) {
+            // covered now
+            Open(neighbour->ref->GetPattern((dir + 2) % 4), -1);
+        }
+        else {
+            Open(ref->GetPattern(dir), 1);
+        }
+    }
 }
 
-bool ColorAxisCounts::CanBeFinished(int k)
+void ColorAxisCounts::Unplace(const Board& board, Board::Loc* loc)
 {
-    return colors_available[k] >= ABS(colors_horizontal[k]) + ABS(colors_vertical[k]);
+    auto ref = loc->ref;
+    for (int dir = 0; dir < 4; ++dir) {
+        auto neighbour = board.GetNeighbour(loc, dir);
+        if (neighbour->ref) {
+            Open(neighbour->ref->GetPattern((dir + 2) % 4), 1);
+        }
+        else {
+            Open(ref->GetPattern(dir), -1);
+        }
+    }
+    Unplace(ref->GetPattern(0), ref->GetPattern(1), ref->GetPattern(2), ref->GetPattern(3));
 }
 
-bool ColorAxisCounts::IsFinished()
+bool ColorAxisCounts::CanBeFinished() const
 {
-    bool finished = std::all_of(colors_horizontal.begin(), colors_horizontal.end(), [](int i) { return i == 0; });
-    finished = finished && std::all_of(colors_vertical.begin(), colors_vertical.end(), [](int i) { return i == 0; });
-    finished = finished && std::all_of(colors_available.begin(), colors_available.end(), [](int i) { return i == 0; });
-    return finished;
+    // needed = max(|horizontal| + |vertical|, open), must not exceed available
+    for (int i = 0; i < blocks * BLOCK; i += BLOCK) {
+#ifdef __AVX2__
+        __m256i h = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(colors_horizontal + i));
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(colors_vertical + i));
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(colors_available + i));
+        __m256i o = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(colors_open + i));
+        __m256i needed = _mm256_max_epi32(_mm256_add_epi32(_mm256_abs_epi32(h), _mm256_abs_epi32(v)), o);
+        __m256i missing = _mm256_cmpgt_epi32(needed, a);
+        if (!_mm256_testz_si256(missing, missing)) {
+            return false;
+        }
+#else
+        int missing = 0;
+        for (int k = i; k < i + BLOCK; ++k) {
+            int needed = std::max(std::abs(colors_horizontal[k]) + std::abs(colors_vertical[k]), colors_open[k]);
+            missing |= (needed > colors_available[k]) ? 1 : 0;
+        }
+        if (missing) {
+            return false;
+        }
+#endif
+    }
+    return true;
 }
 
-void ColorAxisCounts::InitColor(int k)
+bool ColorAxisCounts::IsFinished() const
 {
-    if (k >= colors_available.size()) {
-        colors_available.resize(k + 1);
-        colors_horizontal.resize(k + 1);
-        colors_vertical.resize(k + 1);
+    for (int k = 0; k < blocks * BLOCK; ++k) {
+        if (colors_horizontal[k] || colors_vertical[k] || colors_available[k]) {
+            return false;
+        }
     }
-    colors_available[k] += 1;
+    return true;
+}
+
+void ColorAxisCounts::Open(int k, int count)
+{
+    colors_open[compact[k]] += count;
 }
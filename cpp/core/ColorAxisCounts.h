@@ -1,36 +1,60 @@
 #pragma once
 
-#include <vector>
+#include <cstdint>
+#include "Board.h"
 #include "PuzzleDef.h"
 
 namespace edge {
 
 namespace backtracker {
 
+// Per colour balance of placed sides on each axis and count of sides still
+// available on unplaced pieces. With board given, also counts sides of placed
+// pieces (and frame) facing empty locations, each of them has to be covered by
+// an available side of the same colour. All colours are checked at once, in
+// blocks of 8 counters.
 class ColorAxisCounts
 {
 
 public:
+    static const int MAX_COLORS = 64;
+
+    // counts only pieces, for checking rotations without positions
     void Init(const PuzzleDef* def);
 
+    // counts also pieces already on the board and sides facing empty locations
+    void Init(Board& board);
+
     void Place(int k0, int k1, int k2, int k3);
 
     void Unplace(int k0, int k1, int k2, int k3);
 
-    bool CanBeFinished(int k);
+    // must be called after the piece was put on location
+    void Place(const Board& board, Board::Loc* loc);
+
+    // must be called before the piece is removed from location
+    void Unplace(const Board& board, Board::Loc* loc);
 
-    bool IsFinished();
+    // whether available sides can still balance both axes and cover all
+    // sides facing empty locations, for every colour
+    bool CanBeFinished() const;
+
+    bool IsFinished() const;
 
 private:
+    static const int BLOCK = 8;
 
-    void InitColor(int k);
+    void Open(int k, int count);
 
-    std::vector<int> colors_horizontal;
-    std::vector<int> colors_vertical;
-    std::vector<int> colors_available;
+    int blocks; // used colours rounded up to BLOCK
+    uint8_t compact[256]; // pattern -> colour index
+    alignas(32) int32_t colors_horizontal[MAX_COLORS];
+    alignas(32) int32_t colors_vertical[MAX_COLORS];
+    alignas(32) int32_t colors_available[MAX_COLORS];
+    alignas(32) int32_t colors_open[MAX_COLORS]; // sides facing empty locations
 
 };
 
 }
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,54 @@
+#include "CompletionTable.h"
+
+using namespace edge::backtracker;
+
+CompletionTable::CompletionTable(size_t megabytes) : probes(0), hits(0), stores(0), nodes(0)
+{
+    size_t capacity = 1;
+    while (2 * capacity * sizeof(uint64_t) <= (megabytes << 20)) {
+        capacity *= 2;
+    }
+    slots.reset(new std::atomic<uint64_t>[capacity]);
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i].store(0, std::memory_order_relaxed);
+    }
+    mask = capacity - 1;
+}
+
+void CompletionTable::Count(long long probes, long long hits, long long stores, long long nodes)
+{
+    this->probes += probes;
+    this->hits += hits;
+    this->stores += stores;
+    this->nodes += nodes;
+}
+
+long long CompletionTable::GetProbes() const
+{
+    return probes;
+}
+
+long long CompletionTable::GetHits() const
+{
+    return hits;
+}
+
+long long CompletionTable::GetStores() const
+{
+    return stores;
+}
+
+long long CompletionTable::GetNodes() const
+{
+    return nodes;
+}
+
+size_t CompletionTable::GetCapacity() const
+{
+    return mask + 1;
+}
+
+size_t CompletionTable::GetMemory() const
+{
+    return GetCapacity() * sizeof(uint64_t);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace edge {
+
+namespace backtracker {
+
+// Bounded table of search nodes near the end of the path with the number of
+// further placements reachable from them (all of them if the node can be
+// completed). Key and the number share one atomic word, the number in its low
+// byte, so one table can be shared by several searching threads without
+// locking. Each key has single slot given by its next bits, newer key simply
+// replaces older one.
+class CompletionTable {
+public:
+    static const int MAX_PLACEMENTS = 0xff;
+
+    // size is rounded down to power of two slots
+    CompletionTable(size_t megabytes);
+
+    CompletionTable(const CompletionTable& other) = delete;
+
+    CompletionTable& operator=(const CompletionTable& other) = delete;
+
+    // false if the key is not stored
+    bool Find(uint64_t key, int& placements) const
+    {
+        key = Tag(key);
+        uint64_t slot = slots[(key >> 8) & mask].load(std::memory_order_relaxed);
+        if ((slot & ~0xffull) != key) {
+            return false;
+        }
+        placements = static_cast<int>(slot & 0xff);
+        return true;
+    }
+
+    void Add(uint64_t key, int placements)
+    {
+        key = Tag(key);
+        slots[(key >> 8) & mask].store(key | static_cast<uint64_t>(placements), std::memory_order_relaxed);
+    }
+
+    // statistics are counted by searches themselves and added in batches
+    void Count(long long probes, long long hits, long long stores, long long nodes);
+
+    long long GetProbes() const;
+
+    long long GetHits() const;
+
+    long long GetStores() const;
+
+    // placements tried while finding completions of stored nodes
+    long long GetNodes() const;
+
+    size_t GetCapacity() const;
+
+    size_t GetMemory() const; // in bytes
+
+private:
+    // key without the low byte, never 0, which marks empty slot
+    static uint64_t Tag(uint64_t key)
+    {
+        key &= ~0xffull;
+        return key ? key : 0x100;
+    }
+
+    std::unique_ptr< std::atomic<uint64_t>[] > slots;
+    size_t mask;
+    std::atomic<long long> probes;
+    std::atomic<long long> hits;
+    std::atomic<long long> stores;
+    std::atomic<long long> nodes;
+
+};
+
+}
+
+}
@@ -4,27 +4,21 @@
 
 using namespace edge;
 
-PieceRef::PieceRef(PieceDef def, int dir)
-    : def(def), dir(dir)
+PieceRef::PieceRef() : patterns(0), id(0), dir(0)
 {
-    for (int i = 0; i < 4; ++i) {
-        oriented_patterns[i] = def.patterns[(i - dir + 4) % 4];
-    }
-}
-
-int PieceRef::GetPattern(int pos) const
-{
-    return oriented_patterns[pos];
 }
 
-int PieceRef::GetDir() const
+PieceRef::PieceRef(const PieceDef& def, int dir)
+    : patterns(0), id(static_cast<uint16_t>(def.id)), dir(static_cast<uint8_t>(dir))
 {
-    return dir;
-}
+    for (int i = 0; i < 4; ++i) {
+        patterns |= static_cast<uint32_t>(def.patterns[i]) << (8 * i);
+    }
 
-int PieceRef::GetId() const
-{
-    return def.id;
+    // pattern at i moves to i + dir
+    if (dir != 0) {
+        patterns = (patterns << (8 * dir)) | (patterns >> (32 - 8 * dir));
+    }
 }
 
 void edge::ParseNumberLine(const std::string& line, std::vector<int>& vals)
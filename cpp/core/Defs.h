@@ -33,23 +33,51 @@ struct HintDef
     int x, y, id, dir;
 };
 
+// piece in given rotation, patterns are packed by 8 bits starting with EAST
+// in the lowest byte, so that rotating the piece is rotating the packed value
 class PieceRef
 {
 public:
-    PieceRef(PieceDef def, int dir);
+    PieceRef();
 
-    int GetPattern(int pos) const;
+    PieceRef(const PieceDef& def, int dir);
 
-    int GetDir() const;
+    int GetPattern(int pos) const
+    {
+        return (patterns >> (8 * pos)) & 0xff;
+    }
 
-    int GetId() const;
+    uint32_t GetPatterns() const
+    {
+        return patterns;
+    }
+
+    int GetDir() const
+    {
+        return dir;
+    }
+
+    int GetId() const
+    {
+        return id;
+    }
 
 private:
-    PieceDef def;
-    int dir;
-    uint8_t oriented_patterns[4];
+    uint32_t patterns;
+    uint16_t id;
+    uint8_t dir;
 };
 
 void ParseNumberLine(const std::string& line, std::vector<int>& vals);
 
+// bijective mix of 64 bits (splitmix64 finalizer), gives keys of Zobrist
+// hashing the same in every process without storing them
+inline uint64_t MixHash(uint64_t value)
+{
+    value += 0x9e3779b97f4a7c15ull;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+    return value ^ (value >> 31);
+}
+
 }
\ No newline at end of file
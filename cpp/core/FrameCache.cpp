@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <exception>
+#include "FrameCache.h"
+
+using namespace edge::backtracker;
+
+static const int64_t CACHE_KIND = 0x314d5246; // "FRM1"
+
+FrameCache::FrameCache(const std::string& filename, int length, uint64_t fingerprint)
+    : length(length), count(0), stored(0), complete(false), next(0), buffer(2 * length)
+{
+    file.open(filename, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file) {
+        // new cache
+        std::ofstream create(filename, std::ios::binary);
+        create.close();
+        file.open(filename, std::ios::in | std::ios::out | std::ios::binary);
+        if (!file) {
+            throw std::exception("Unable to open frame cache!");
+        }
+        WriteValue(0, CACHE_KIND);
+        WriteValue(1, length);
+        WriteValue(2, static_cast<int64_t>(fingerprint));
+        WriteValue(3, 0);
+        WriteValue(4, 0);
+        file.flush();
+        return;
+    }
+
+    if (ReadValue(0) != CACHE_KIND || ReadValue(1) != length ||
+        ReadValue(2) != static_cast<int64_t>(fingerprint)) {
+        throw std::exception("Frame cache belongs to other puzzle or hints!");
+    }
+    complete = ReadValue(3) != 0;
+    next = ReadValue(4);
+
+    file.seekg(0, std::ios::end);
+    long long size = static_cast<long long>(file.tellg()) - 8 * HEADER_VALUES;
+    count = size / static_cast<long long>(buffer.size());
+    stored = count;
+}
+
+FrameCache::~FrameCache()
+{
+    try {
+        Flush();
+    }
+    catch (...) {
+
+    }
+}
+
+long long FrameCache::GetCount() const
+{
+    return count;
+}
+
+void FrameCache::Read(long long index, std::vector<int>& frame)
+{
+    if (index >= stored) {
+        auto start = appended.begin() + (index - stored) * buffer.size();
+        std::copy(start, start + buffer.size(), buffer.begin());
+    }
+    else {
+        file.seekg(8 * HEADER_VALUES + index * static_cast<long long>(buffer.size()));
+        file.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+        if (!file) {
+            throw std::exception("Unable to read frame cache!");
+        }
+    }
+    frame.resize(length);
+    for (int pos = 0; pos < length; ++pos) {
+        frame[pos] = buffer[2 * pos] | (buffer[2 * pos + 1] << 8);
+    }
+}
+
+void FrameCache::Append(const std::vector<int>& frame)
+{
+    for (int pos = 0; pos < length; ++pos) {
+        appended.push_back(static_cast<uint8_t>(frame[pos]));
+        appended.push_back(static_cast<uint8_t>(frame[pos] >> 8));
+    }
+    ++count;
+}
+
+bool FrameCache::IsComplete() const
+{
+    return complete;
+}
+
+void FrameCache::SetComplete()
+{
+    // only once all frames are stored
+    Flush();
+    complete = true;
+    WriteValue(3, 1);
+    file.flush();
+}
+
+long long FrameCache::GetNext() const
+{
+    return next;
+}
+
+void FrameCache::SetNext(long long next)
+{
+    this->next = next;
+}
+
+void FrameCache::Flush()
+{
+    if (!appended.empty()) {
+        file.seekp(8 * HEADER_VALUES + stored * static_cast<long long>(buffer.size()));
+        file.write(reinterpret_cast<const char*>(appended.data()), appended.size());
+        appended.clear();
+        stored = count;
+    }
+    WriteValue(4, next);
+    file.flush();
+    if (!file) {
+        throw std::exception("Unable to write frame cache!");
+    }
+}
+
+void FrameCache::WriteValue(int index, int64_t val)
+{
+    // little endian regardless of platform
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = static_cast<uint8_t>(static_cast<uint64_t>(val) >> (8 * i));
+    }
+    file.seekp(8 * index);
+    file.write(reinterpret_cast<const char*>(bytes), 8);
+}
+
+int64_t FrameCache::ReadValue(int index)
+{
+    uint8_t bytes[8] = {};
+    file.seekg(8 * index);
+    file.read(reinterpret_cast<char*>(bytes), 8);
+    uint64_t val = 0;
+    for (int i = 0; i < 8; ++i) {
+        val |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+    }
+    return static_cast<int64_t>(val);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace edge {
+
+namespace backtracker {
+
+// Frames produced by FrameSolver stored in binary file, so that they are never
+// enumerated again, together with index of the next frame whose interior is
+// to be searched. Header of 8 byte little endian values (kind, frame length,
+// fingerprint, complete, next) is followed by frames, 2 bytes per piece id.
+// Frame being appended when the process ends is ignored and written again.
+// Appended frames and the next index are kept in memory until Flush, frames
+// searched since the last one are searched again after restart.
+class FrameCache {
+public:
+    // opens or creates the file, throws if it holds frames of other puzzle
+    FrameCache(const std::string& filename, int length, uint64_t fingerprint);
+
+    ~FrameCache();
+
+    FrameCache(const FrameCache& other) = delete;
+
+    FrameCache& operator=(const FrameCache& other) = delete;
+
+    long long GetCount() const;
+
+    void Read(long long index, std::vector<int>& frame);
+
+    void Append(const std::vector<int>& frame);
+
+    // all frames are stored
+    bool IsComplete() const;
+
+    void SetComplete();
+
+    // first frame whose interior was not searched yet
+    long long GetNext() const;
+
+    void SetNext(long long next);
+
+    // writes appended frames and the next index into the file
+    void Flush();
+
+private:
+    static const int HEADER_VALUES = 5;
+
+    void WriteValue(int index, int64_t val);
+
+    int64_t ReadValue(int index);
+
+    std::fstream file;
+    int length;
+    long long count;
+    long long stored; // frames written into the file
+    bool complete;
+    long long next;
+    std::vector<uint8_t> buffer; // one frame
+    std::vector<uint8_t> appended; // frames not written yet
+
+};
+
+}
+
+}
@@ -0,0 +1,294 @@
+#include <exception>
+#include <map>
+#include "FrameSolver.h"
+
+using namespace edge::backtracker;
+
+static int Direction(int x, int y, int to_x, int to_y)
+{
+    if (to_y == y + 1) {
+        return edge::EAST;
+    }
+    if (to_x == x + 1) {
+        return edge::SOUTH;
+    }
+    return (to_y == y - 1) ? edge::WEST : edge::NORTH;
+}
+
+FrameSolver::FrameSolver(const PuzzleDef* def) : def(def), depth(0), finished(false)
+{
+    int height = def->GetHeight();
+    int width = def->GetWidth();
+    if (height < 3 || width < 3) {
+        throw std::exception("Frame needs board of at least 3x3!");
+    }
+
+    // clockwise from top left corner
+    std::vector< std::pair<int, int> > ring;
+    for (int y = 0; y < width; ++y) {
+        ring.push_back(std::pair<int, int>(0, y));
+    }
+    for (int x = 1; x < height; ++x) {
+        ring.push_back(std::pair<int, int>(x, width - 1));
+    }
+    for (int y = width - 2; y >= 0; --y) {
+        ring.push_back(std::pair<int, int>(height - 1, y));
+    }
+    for (int x = height - 2; x > 0; --x) {
+        ring.push_back(std::pair<int, int>(x, 0));
+    }
+
+    std::map< std::pair<int, int>, HintDef > hints;
+    for (auto& hint : def->GetHints()) {
+        hints.insert(std::make_pair(std::pair<int, int>(hint.x, hint.y), hint));
+    }
+
+    int length = static_cast<int>(ring.size());
+    for (int pos = 0; pos < length; ++pos) {
+        Cell cell;
+        cell.x = ring[pos].first;
+        cell.y = ring[pos].second;
+        auto& prev = ring[(pos + length - 1) % length];
+        auto& next = ring[(pos + 1) % length];
+        cell.prev = Direction(cell.x, cell.y, prev.first, prev.second);
+        cell.next = Direction(cell.x, cell.y, next.first, next.second);
+
+        int outs = 0;
+        cell.out[1] = -1;
+        cell.inner = -1;
+        for (int dir = 0; dir < 4; ++dir) {
+            bool outside = (dir == NORTH && cell.x == 0) || (dir == SOUTH && cell.x == height - 1) ||
+                (dir == WEST && cell.y == 0) || (dir == EAST && cell.y == width - 1);
+            if (outside) {
+                cell.out[outs++] = dir;
+            }
+            else if (dir != cell.prev && dir != cell.next) {
+                cell.inner = dir;
+            }
+        }
+
+        cell.hint = 0;
+        cell.inner_pattern = -1;
+        auto hint = hints.find(ring[pos]);
+        if (hint != hints.end()) {
+            cell.hint = hint->second.id;
+        }
+        if (cell.inner != -1) {
+            int x = cell.x + (cell.inner == SOUTH ? 1 : (cell.inner == NORTH ? -1 : 0));
+            int y = cell.y + (cell.inner == EAST ? 1 : (cell.inner == WEST ? -1 : 0));
+            hint = hints.find(std::pair<int, int>(x, y));
+            if (hint != hints.end()) {
+                PieceRef ref(def->GetPieceDef(hint->second.id), hint->second.dir != -1 ? hint->second.dir : 0);
+                cell.inner_pattern = ref.GetPattern((cell.inner + 2) % 4);
+            }
+        }
+        cells.push_back(cell);
+    }
+
+    if (def->GetCorners().size() != 4 || static_cast<int>(def->GetEdges().size()) != length - 4) {
+        throw std::exception("Border pieces do not fill the border!");
+    }
+
+    // colours along the cycle do not depend on the location, as long as it is
+    // of the same kind, first corner and first edge location are used
+    piece_index.assign(def->GetPieceCount() + 1, -1);
+    corners_by_in.resize(256);
+    edges_by_in.resize(256);
+    for (int kind = 0; kind < 2; ++kind) {
+        const Cell& cell = cells[kind];
+        for (auto& piece_def : kind == 0 ? def->GetCorners() : def->GetEdges()) {
+            int dir = 0;
+            while (dir < 4 && !(PieceRef(piece_def, dir).GetPattern(cell.out[0]) == 0 &&
+                (cell.out[1] == -1 || PieceRef(piece_def, dir).GetPattern(cell.out[1]) == 0))) {
+                ++dir;
+            }
+            if (dir == 4) {
+                throw std::exception("Border piece without border pattern!");
+            }
+
+            PieceRef ref(piece_def, dir);
+            Piece piece;
+            piece.id = piece_def.id;
+            piece.in = ref.GetPattern(cell.prev);
+            piece.out = ref.GetPattern(cell.next);
+            piece.inner = (cell.inner != -1) ? ref.GetPattern(cell.inner) : -1;
+            piece_index[piece.id] = static_cast<int>(pieces.size());
+            if (kind == 0) {
+                corners_by_in[piece.in].push_back(static_cast<int>(pieces.size()));
+                all_corners.push_back(static_cast<int>(pieces.size()));
+            }
+            else {
+                edges_by_in[piece.in].push_back(static_cast<int>(pieces.size()));
+            }
+            pieces.push_back(piece);
+        }
+    }
+
+    used.assign(def->GetPieceCount() + 1, false);
+    hinted.resize(length);
+    for (auto& hint : def->GetHints()) {
+        used[hint.id] = true;
+    }
+    for (int pos = 0; pos < length; ++pos) {
+        if (cells[pos].hint) {
+            if (piece_index[cells[pos].hint] == -1) {
+                throw std::exception("Hint on border is not a border piece!");
+            }
+            hinted[pos].push_back(piece_index[cells[pos].hint]);
+        }
+    }
+    chosen.assign(length, -1);
+    cursor.assign(length, 0);
+
+    fingerprint = MixHash((static_cast<uint64_t>(height) << 32) | static_cast<uint64_t>(width));
+    for (auto& item : def->GetAll()) {
+        uint64_t value = static_cast<uint64_t>(item.first);
+        for (int i = 0; i < 4; ++i) {
+            value = (value << 8) | item.second.patterns[i];
+        }
+        fingerprint = MixHash(fingerprint ^ value);
+    }
+    for (auto& hint : def->GetHints()) {
+        fingerprint = MixHash(fingerprint ^ ((static_cast<uint64_t>(hint.x) << 48) |
+            (static_cast<uint64_t>(hint.y) << 32) | (static_cast<uint64_t>(hint.id) << 8) |
+            static_cast<uint64_t>(hint.dir & 0xff)));
+    }
+}
+
+int FrameSolver::GetLength() const
+{
+    return static_cast<int>(cells.size());
+}
+
+uint64_t FrameSolver::GetFingerprint() const
+{
+    return fingerprint;
+}
+
+bool FrameSolver::Next(std::vector<int>& frame)
+{
+    int length = GetLength();
+    if (finished) {
+        return false;
+    }
+    if (depth == length) {
+        // continue after the last produced frame
+        depth -= 1;
+        if (!cells[depth].hint) {
+            used[pieces[chosen[depth]].id] = false;
+        }
+    }
+
+    while (depth >= 0) {
+        int in = depth ? pieces[chosen[depth - 1]].out : -1;
+        auto& candidates = Candidates(depth, in);
+        int& next = cursor[depth];
+        while (next < static_cast<int>(candidates.size()) && !Fits(depth, in, pieces[candidates[next]])) {
+            ++next;
+        }
+
+        if (next == static_cast<int>(candidates.size())) {
+            // all tried, back to previous location
+            next = 0;
+            depth -= 1;
+            if (depth >= 0 && !cells[depth].hint) {
+                used[pieces[chosen[depth]].id] = false;
+            }
+            continue;
+        }
+
+        chosen[depth] = candidates[next++];
+        if (!cells[depth].hint) {
+            used[pieces[chosen[depth]].id] = true;
+        }
+        depth += 1;
+        if (depth == length) {
+            frame.resize(length);
+            for (int pos = 0; pos < length; ++pos) {
+                frame[pos] = pieces[chosen[pos]].id;
+            }
+            return true;
+        }
+        cursor[depth] = 0;
+    }
+
+    finished = true;
+    return false;
+}
+
+void FrameSolver::Seek(const std::vector<int>& frame)
+{
+    int length = GetLength();
+    if (static_cast<int>(frame.size()) != length) {
+        throw std::exception("Frame does not belong to this puzzle!");
+    }
+
+    std::fill(used.begin(), used.end(), false);
+    for (auto& hint : def->GetHints()) {
+        used[hint.id] = true;
+    }
+    for (int pos = 0; pos < length; ++pos) {
+        int in = pos ? pieces[chosen[pos - 1]].out : -1;
+        auto& candidates = Candidates(pos, in);
+        int index = 0;
+        while (index < static_cast<int>(candidates.size()) && pieces[candidates[index]].id != frame[pos]) {
+            ++index;
+        }
+        if (index == static_cast<int>(candidates.size()) || !Fits(pos, in, pieces[candidates[index]])) {
+            throw std::exception("Frame does not belong to this puzzle!");
+        }
+        chosen[pos] = candidates[index];
+        cursor[pos] = index + 1;
+        if (!cells[pos].hint) {
+            used[frame[pos]] = true;
+        }
+    }
+    depth = length;
+    finished = false;
+}
+
+void FrameSolver::GetPlacements(const std::vector<int>& frame, std::vector<HintDef>& placements) const
+{
+    placements.clear();
+    for (int pos = 0; pos < GetLength(); ++pos) {
+        auto& cell = cells[pos];
+        if (cell.hint) {
+            continue;
+        }
+        auto piece_def = def->GetPieceDef(frame[pos]);
+        for (int dir = 0; dir < 4; ++dir) {
+            PieceRef ref(piece_def, dir);
+            if (ref.GetPattern(cell.out[0]) == 0 && (cell.out[1] == -1 || ref.GetPattern(cell.out[1]) == 0)) {
+                placements.push_back(HintDef(cell.x, cell.y, frame[pos], dir));
+                break;
+            }
+        }
+    }
+}
+
+const std::vector< int >& FrameSolver::Candidates(int pos, int in) const
+{
+    if (cells[pos].hint) {
+        return hinted[pos];
+    }
+    if (pos == 0) {
+        return all_corners;
+    }
+    return (cells[pos].inner == -1) ? corners_by_in[in] : edges_by_in[in];
+}
+
+bool FrameSolver::Fits(int pos, int in, const Piece& piece) const
+{
+    auto& cell = cells[pos];
+    if (cell.hint ? piece.id != cell.hint : used[piece.id]) {
+        return false;
+    }
+    if (pos > 0 && piece.in != in) {
+        return false;
+    }
+    if (cell.inner_pattern != -1 && piece.inner != cell.inner_pattern) {
+        return false;
+    }
+    // the cycle closes at the first location
+    return pos + 1 < GetLength() || piece.out == pieces[chosen[0]].in;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "PuzzleDef.h"
+
+namespace edge {
+
+namespace backtracker {
+
+// Enumerates all frames, i.e. corner and edge pieces filling the border of the
+// board, matching each other and the hints. The border is a cycle of locations
+// clockwise from the top left corner, every piece on it has its rotation given
+// by the location (border patterns facing out), so each piece only connects
+// colour coming from the previous location to colour going to the next one.
+// Frames are produced one by one, ordered by candidates of the locations along
+// the cycle, so that enumeration can be continued after any produced frame.
+class FrameSolver
+{
+public:
+    FrameSolver(const PuzzleDef* def);
+
+    // number of border locations, i.e. piece ids in a frame
+    int GetLength() const;
+
+    // identifies puzzle and hints the frames are valid for
+    uint64_t GetFingerprint() const;
+
+    // next frame (piece id per border location), false once all were produced
+    bool Next(std::vector<int>& frame);
+
+    // continues enumeration right after given frame (as returned by Next)
+    void Seek(const std::vector<int>& frame);
+
+    // frame pieces in rotation required by their location, except those
+    // already given by hints
+    void GetPlacements(const std::vector<int>& frame, std::vector<HintDef>& placements) const;
+
+private:
+    struct Cell {
+        int x, y;
+        int out[2]; // directions towards the border, second is -1 for edge
+        int prev, next; // directions towards neighbouring border locations
+        int inner; // direction towards the interior, -1 for corner
+        int hint; // id of hint piece placed here, 0 if none
+        int inner_pattern; // pattern of hint facing it from the interior, -1 if none
+    };
+
+    // piece as seen when going around the border
+    struct Piece {
+        int id;
+        int in, out; // colours facing previous and next location
+        int inner; // colour facing the interior, -1 for corner
+    };
+
+    // pieces which can go to border location at pos, given colour coming into it
+    const std::vector< int >& Candidates(int pos, int in) const;
+
+    // in - colour going out of previous location
+    bool Fits(int pos, int in, const Piece& piece) const;
+
+    const PuzzleDef* def;
+    std::vector< Cell > cells;
+    std::vector< Piece > pieces;
+    std::vector< int > piece_index; // piece id -> index in pieces, -1 if not on border
+    std::vector< std::vector< int > > corners_by_in; // colour -> corner pieces
+    std::vector< std::vector< int > > edges_by_in; // colour -> edge pieces
+    std::vector< int > all_corners;
+    std::vector< std::vector< int > > hinted; // pos -> its hint piece alone
+    std::vector< bool > used; // by piece id, including hints
+    std::vector< int > chosen; // pos -> index in pieces
+    std::vector< int > cursor; // pos -> next candidate to try
+    int depth; // number of chosen locations
+    bool finished;
+    uint64_t fingerprint;
+
+};
+
+}
+
+}
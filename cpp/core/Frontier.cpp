@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <functional>
+#include "Frontier.h"
+
+using namespace edge::backtracker;
+
+void Frontier::Init(Board& board, const CandidateTable& table, const std::vector< Board::Loc* >& locations)
+{
+    auto def = board.GetPuzzleDef();
+    this->board = &board;
+    this->table = &table;
+    origin = board.GetLocation(-1, -1);
+    remaining = 0;
+
+    // keys of every piece, once per occurrence in the bucket, pieces already
+    // on the board are not counted
+    auto& locations_map = board.GetLocations();
+    int max_count = 0;
+    key_counts.assign(table.GetKeyCount(), 0);
+    piece_offsets.assign(def->GetPieceCount() + 2, 0);
+    for (int key = 0; key < table.GetKeyCount(); ++key) {
+        auto bucket = table.Get(key);
+        max_count = std::max(max_count, bucket.size());
+        for (auto& piece : bucket) {
+            piece_offsets[piece->GetId() + 1] += 1;
+            if (!locations_map[piece->GetId()]) {
+                key_counts[key] += 1;
+            }
+        }
+    }
+    for (size_t id = 1; id < piece_offsets.size(); ++id) {
+        piece_offsets[id] += piece_offsets[id - 1];
+    }
+    std::vector< int > fill(piece_offsets.begin(), piece_offsets.end() - 1);
+    piece_keys.resize(piece_offsets.back());
+    for (int key = 0; key < table.GetKeyCount(); ++key) {
+        for (auto& piece : table.Get(key)) {
+            piece_keys[fill[piece->GetId()]++] = key;
+        }
+    }
+
+    key_heads.assign(table.GetKeyCount(), -1);
+    queue_heads.assign(max_count + 1, -1);
+    holes.assign((def->GetHeight() + 2) * (def->GetWidth() + 2), Hole{ nullptr, 0, -1, -1, -1, -1, -1, false, false });
+    for (int x = -1; x <= def->GetHeight(); ++x) {
+        for (int y = -1; y <= def->GetWidth(); ++y) {
+            holes[Index(board.GetLocation(x, y))].loc = board.GetLocation(x, y);
+        }
+    }
+
+    order.clear();
+    for (auto loc : locations) {
+        order.push_back(Index(loc));
+    }
+    std::sort(order.begin(), order.end(), [this](int a, int b) {
+        return std::less< Board::Loc* >()(holes[a].loc, holes[b].loc);
+    });
+    order.erase(std::unique(order.begin(), order.end()), order.end());
+    for (auto hole : order) {
+        holes[hole].member = true;
+        if (!holes[hole].loc->ref) {
+            holes[hole].active = true;
+            remaining += 1;
+            Attach(hole);
+        }
+    }
+}
+
+void Frontier::Place(Board::Loc* loc)
+{
+    int hole = Index(loc);
+    if (holes[hole].active) {
+        Detach(hole);
+        holes[hole].active = false;
+        remaining -= 1;
+    }
+
+    int id = loc->ref->GetId();
+    for (int i = piece_offsets[id]; i < piece_offsets[id + 1]; ++i) {
+        AdjustKey(piece_keys[i], -1);
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        int neighbour = Index(board->GetNeighbour(loc, i));
+        if (holes[neighbour].active) {
+            Detach(neighbour);
+            Attach(neighbour);
+        }
+    }
+}
+
+void Frontier::Unplace(Board::Loc* loc, const PieceRef* ref)
+{
+    for (int i = 0; i < 4; ++i) {
+        int neighbour = Index(board->GetNeighbour(loc, i));
+        if (holes[neighbour].active) {
+            Detach(neighbour);
+            Attach(neighbour);
+        }
+    }
+
+    int id = ref->GetId();
+    for (int i = piece_offsets[id]; i < piece_offsets[id + 1]; ++i) {
+        AdjustKey(piece_keys[i], 1);
+    }
+
+    int hole = Index(loc);
+    if (holes[hole].member) {
+        holes[hole].active = true;
+        remaining += 1;
+        Attach(hole);
+    }
+}
+
+int Frontier::Select(bool all, Board::Loc*& loc) const
+{
+    if (all) {
+        int best = -1;
+        for (auto hole : order) {
+            if (!holes[hole].active) {
+                continue;
+            }
+            int count = key_counts[holes[hole].key];
+            if (count == 0) {
+                loc = holes[hole].loc;
+                return 0;
+            }
+            if (best == -1 || count < best) {
+                best = count;
+                loc = holes[hole].loc;
+            }
+        }
+        return best;
+    }
+
+    for (int bucket = 0; bucket < static_cast<int>(queue_heads.size()); ++bucket) {
+        if (queue_heads[bucket] == -1) {
+            continue;
+        }
+        int best = queue_heads[bucket];
+        for (int hole = holes[best].queue_next; hole != -1; hole = holes[hole].queue_next) {
+            if (std::less< Board::Loc* >()(holes[hole].loc, holes[best].loc)) {
+                best = hole;
+            }
+        }
+        loc = holes[best].loc;
+        return bucket;
+    }
+    return -1;
+}
+
+int Frontier::GetCount(const Board::Loc* loc) const
+{
+    return key_counts[holes[Index(loc)].key];
+}
+
+int Frontier::GetRemaining() const
+{
+    return remaining;
+}
+
+int Frontier::Index(const Board::Loc* loc) const
+{
+    return static_cast<int>(loc - origin);
+}
+
+void Frontier::Attach(int hole)
+{
+    auto& item = holes[hole];
+    item.key = table->Encode(board->GetNeighbourPattern(item.loc, EAST, ANY_COLOR),
+        board->GetNeighbourPattern(item.loc, SOUTH, ANY_COLOR),
+        board->GetNeighbourPattern(item.loc, WEST, ANY_COLOR),
+        board->GetNeighbourPattern(item.loc, NORTH, ANY_COLOR));
+    item.key_prev = -1;
+    item.key_next = key_heads[item.key];
+    if (item.key_next != -1) {
+        holes[item.key_next].key_prev = hole;
+    }
+    key_heads[item.key] = hole;
+
+    // only locations connected to already placed pieces are queued
+    if (board->GetNeighbour(item.loc, EAST)->IsPlaced() || board->GetNeighbour(item.loc, SOUTH)->IsPlaced() ||
+        board->GetNeighbour(item.loc, WEST)->IsPlaced() || board->GetNeighbour(item.loc, NORTH)->IsPlaced()) {
+        Enqueue(hole, key_counts[item.key]);
+    }
+}
+
+void Frontier::Detach(int hole)
+{
+    auto& item = holes[hole];
+    Dequeue(hole);
+    if (item.key_prev != -1) {
+        holes[item.key_prev].key_next = item.key_next;
+    }
+    else {
+        key_heads[item.key] = item.key_next;
+    }
+    if (item.key_next != -1) {
+        holes[item.key_next].key_prev = item.key_prev;
+    }
+}
+
+void Frontier::AdjustKey(int key, int delta)
+{
+    key_counts[key] += delta;
+    for (int hole = key_heads[key]; hole != -1; hole = holes[hole].key_next) {
+        if (holes[hole].bucket != -1) {
+            Dequeue(hole);
+            Enqueue(hole, key_counts[key]);
+        }
+    }
+}
+
+void Frontier::Enqueue(int hole, int bucket)
+{
+    auto& item = holes[hole];
+    item.bucket = bucket;
+    item.queue_prev = -1;
+    item.queue_next = queue_heads[bucket];
+    if (item.queue_next != -1) {
+        holes[item.queue_next].queue_prev = hole;
+    }
+    queue_heads[bucket] = hole;
+}
+
+void Frontier::Dequeue(int hole)
+{
+    auto& item = holes[hole];
+    if (item.bucket == -1) {
+        return;
+    }
+    if (item.queue_prev != -1) {
+        holes[item.queue_prev].queue_next = item.queue_next;
+    }
+    else {
+        queue_heads[item.bucket] = item.queue_next;
+    }
+    if (item.queue_next != -1) {
+        holes[item.queue_next].queue_prev = item.queue_prev;
+    }
+    item.bucket = -1;
+}
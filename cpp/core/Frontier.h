@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include "Board.h"
+#include "CandidateTable.h"
+
+namespace edge {
+
+namespace backtracker {
+
+// Empty locations together with their number of candidates, kept up to date
+// while pieces are placed and removed. Number of candidates is tracked per
+// CandidateTable key, placing a piece thus only touches keys it is registered
+// under and locations currently having those keys. Locations with at least one
+// placed neighbour are kept in bucket queue ordered by number of candidates.
+class Frontier
+{
+public:
+    // locations - locations to be filled, table must be already built
+    void Init(Board& board, const CandidateTable& table, const std::vector< Board::Loc* >& locations);
+
+    // must be called after the piece was put on the board
+    void Place(Board::Loc* loc);
+
+    // must be called after the piece (ref) was removed from the board
+    void Unplace(Board::Loc* loc, const PieceRef* ref);
+
+    // location with the fewest candidates, first in address order on tie,
+    // all - consider also locations without placed neighbour
+    // returns its number of candidates, 0 if any considered location has none
+    // (loc is then that location), -1 if there is nothing to consider
+    int Select(bool all, Board::Loc*& loc) const;
+
+    int GetCount(const Board::Loc* loc) const;
+
+    int GetRemaining() const;
+
+private:
+    struct Hole {
+        Board::Loc* loc;
+        int key;
+        int bucket; // bucket queue position, -1 if not queued
+        int key_prev, key_next;
+        int queue_prev, queue_next;
+        bool member; // to be filled
+        bool active; // to be filled and still empty
+    };
+
+    int Index(const Board::Loc* loc) const;
+
+    void Attach(int hole);
+
+    void Detach(int hole);
+
+    void AdjustKey(int key, int delta);
+
+    void Enqueue(int hole, int bucket);
+
+    void Dequeue(int hole);
+
+    const Board* board;
+    const CandidateTable* table;
+    const Board::Loc* origin; // first location of the board including frame
+    int remaining;
+    std::vector< Hole > holes; // by location, frame ones are never filled
+    std::vector< int > order; // holes to be filled in address order
+    std::vector< int > key_counts; // key -> unplaced rotations in its bucket
+    std::vector< int > key_heads; // key -> first hole having it
+    std::vector< int > queue_heads; // number of candidates -> first queued hole
+    std::vector< int > piece_offsets; // piece id -> range in piece_keys
+    std::vector< int > piece_keys; // keys each piece is registered under
+
+};
+
+}
+
+}
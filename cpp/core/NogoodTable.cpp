@@ -0,0 +1,48 @@
+#include "NogoodTable.h"
+
+using namespace edge::backtracker;
+
+NogoodTable::NogoodTable(size_t megabytes) : probes(0), hits(0), stores(0)
+{
+    size_t capacity = 1;
+    while (2 * capacity * sizeof(uint64_t) <= (megabytes << 20)) {
+        capacity *= 2;
+    }
+    slots.reset(new std::atomic<uint64_t>[capacity]);
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i].store(0, std::memory_order_relaxed);
+    }
+    mask = capacity - 1;
+}
+
+void NogoodTable::Count(long long probes, long long hits, long long stores)
+{
+    this->probes += probes;
+    this->hits += hits;
+    this->stores += stores;
+}
+
+long long NogoodTable::GetProbes() const
+{
+    return probes;
+}
+
+long long NogoodTable::GetHits() const
+{
+    return hits;
+}
+
+long long NogoodTable::GetStores() const
+{
+    return stores;
+}
+
+size_t NogoodTable::GetCapacity() const
+{
+    return mask + 1;
+}
+
+size_t NogoodTable::GetMemory() const
+{
+    return GetCapacity() * sizeof(uint64_t);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace edge {
+
+namespace backtracker {
+
+// Bounded table of 64 bit keys of search nodes whose subtree is proven to have
+// no solution. Each key has single slot given by its low bits, newer key simply
+// replaces older one. Slots are atomic words, so one table can be shared by
+// several searching threads without locking, racing store only loses a key.
+class NogoodTable {
+public:
+    // size is rounded down to power of two slots
+    NogoodTable(size_t megabytes);
+
+    NogoodTable(const NogoodTable& other) = delete;
+
+    NogoodTable& operator=(const NogoodTable& other) = delete;
+
+    bool Contains(uint64_t key) const
+    {
+        key = key ? key : 1; // 0 marks empty slot
+        return slots[key & mask].load(std::memory_order_relaxed) == key;
+    }
+
+    void Add(uint64_t key)
+    {
+        key = key ? key : 1;
+        slots[key & mask].store(key, std::memory_order_relaxed);
+    }
+
+    // statistics are counted by searches themselves and added in batches
+    void Count(long long probes, long long hits, long long stores);
+
+    long long GetProbes() const;
+
+    long long GetHits() const;
+
+    long long GetStores() const;
+
+    size_t GetCapacity() const;
+
+    size_t GetMemory() const; // in bytes
+
+private:
+    std::unique_ptr< std::atomic<uint64_t>[] > slots;
+    size_t mask;
+    std::atomic<long long> probes;
+    std::atomic<long long> hits;
+    std::atomic<long long> stores;
+
+};
+
+}
+
+}
@@ -0,0 +1,379 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Board.h"
+#include "CallbackOnSolve.h"
+#include "CandidateBitsets.h"
+#include "Stats.h"
+
+namespace edge {
+
+namespace backtracker {
+
+// Runs search of Solver (one of the backtrackers) on pool of threads. The
+// search is split at given depth into subtrees on its own thread, while
+// workers already search the subtrees split so far, each with its own solver
+// which replays the placements leading to the subtree first, so that it is
+// searched the same way as without splitting, and is then reused for the next
+// subtree. Idle workers steal from the others, splitting waits while enough
+// subtrees are queued.
+template <class Solver>
+class ParallelSearch {
+public:
+    ParallelSearch(Board& board, bool find_all, const std::string& rotations_file,
+        CandidateEngine engine, int threads, int split_depth)
+        : board(board), find_all(find_all), rotations_file(rotations_file),
+        engine(engine), split_depth(split_depth), best_score(0), steps(0),
+        running(0), stop(false), queued(0), splitting(false), workers(threads),
+        forward_solve(this, true), forward_new_best(this, false), split(this)
+    {
+        stats.Init(board);
+        done.Init(board);
+        split_progress.Init(board);
+        for (auto& worker : workers) {
+            worker.reset(new Worker);
+            worker->progress.Init(board);
+        }
+    }
+
+    ~ParallelSearch()
+    {
+        Stop();
+        Wait();
+    }
+
+    void RegisterOnSolve(CallbackOnSolve* callback)
+    {
+        on_solve.push_back(callback);
+    }
+
+    void RegisterOnNewBest(CallbackOnSolve* callback)
+    {
+        on_new_best.push_back(callback);
+    }
+
+    // called for every created solver (one per worker) before its first step,
+    // may be called on worker threads
+    void SetSolverSetup(const std::function<void(Solver&)>& callback)
+    {
+        setup = callback;
+    }
+
+    // starts splitting (using the board passed in constructor) and the
+    // workers, returns right away
+    void Start()
+    {
+        splitter.reset(new Solver(board, nullptr, find_all, rotations_file, engine));
+        splitter->RegisterOnSolve(&forward_solve);
+        splitter->RegisterOnNewBest(&forward_new_best);
+        splitter->RegisterOnSplit(&split, split_depth);
+        if (setup) {
+            setup(*splitter);
+        }
+        splitting = true;
+
+        running = static_cast<int>(workers.size()) + 1;
+        // rand state may be per thread, seed each thread differently
+        split_thread = std::thread(&ParallelSearch::RunSplit, this, static_cast<unsigned int>(rand()));
+        for (size_t i = 0; i < workers.size(); ++i) {
+            unsigned int seed = static_cast<unsigned int>(rand());
+            workers[i]->thread = std::thread(&ParallelSearch::Run, this, static_cast<int>(i), seed);
+        }
+    }
+
+    // true while splitting or some worker is still searching
+    bool IsRunning() const
+    {
+        return running > 0;
+    }
+
+    // splitting and workers end after their current step
+    void Stop()
+    {
+        stop = true;
+        std::lock_guard<std::mutex> guard(queue_lock);
+        queue_changed.notify_all();
+    }
+
+    void Wait()
+    {
+        if (split_thread.joinable()) {
+            split_thread.join();
+        }
+        for (auto& worker : workers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+
+    // explored space of splitting and all subtrees searched so far
+    Stats& GetStats()
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stats.Clear();
+        stats.Merge(split_progress);
+        stats.Merge(done);
+        for (auto& worker : workers) {
+            stats.Merge(worker->progress);
+        }
+        return stats;
+    }
+
+    long long GetSteps() const
+    {
+        return steps;
+    }
+
+private:
+    static const int PUBLISH_STEPS = 0x10000; // how often workers publish their statistics
+    static const int QUEUED_PER_WORKER = 16; // splitting waits above this many waiting subtrees per worker
+
+    typedef std::vector<HintDef> Task; // placements leading to the subtree
+
+    struct Worker {
+        std::mutex lock;
+        std::deque<Task> tasks;
+        Stats progress; // explored in current task so far
+        std::thread thread;
+    };
+
+    class Forward : public CallbackOnSolve {
+    public:
+        Forward(ParallelSearch* owner, bool solve) : owner(owner), solve(solve)
+        {
+        }
+
+        void Call(Board& board)
+        {
+            std::lock_guard<std::mutex> guard(owner->lock);
+            if (solve) {
+                for (auto& callback : owner->on_solve) {
+                    callback->Call(board);
+                }
+                if (!owner->find_all) {
+                    owner->Stop();
+                }
+            }
+            else {
+                // each worker only knows its own best, report only overall ones
+                int score = board.GetScore();
+                if (score > owner->best_score) {
+                    owner->best_score = score;
+                    for (auto& callback : owner->on_new_best) {
+                        callback->Call(board);
+                    }
+                }
+            }
+        }
+
+    private:
+        ParallelSearch* owner;
+        bool solve;
+    };
+
+    class Split : public CallbackOnSolve {
+    public:
+        Split(ParallelSearch* owner) : owner(owner), next(0)
+        {
+        }
+
+        void Call(Board& /*board*/)
+        {
+            // keeps only limited number of subtrees in memory
+            {
+                std::unique_lock<std::mutex> guard(owner->queue_lock);
+                int limit = QUEUED_PER_WORKER * static_cast<int>(owner->workers.size());
+                owner->queue_changed.wait(guard, [this, limit]() {
+                    return owner->queued < limit || owner->stop;
+                });
+            }
+
+            Task task;
+            owner->splitter->GetPlacements(task);
+
+            // spread in search order, so that each worker starts in different part
+            auto& worker = owner->workers[next];
+            next = (next + 1) % owner->workers.size();
+            {
+                std::lock_guard<std::mutex> guard(worker->lock);
+                worker->tasks.push_back(task);
+            }
+
+            std::lock_guard<std::mutex> guard(owner->queue_lock);
+            owner->queued += 1;
+            owner->queue_changed.notify_all();
+        }
+
+    private:
+        ParallelSearch* owner;
+        size_t next;
+    };
+
+    bool TakeQueued(int index, Task& task)
+    {
+        {
+            // own tasks in search order
+            auto& worker = workers[index];
+            std::lock_guard<std::mutex> guard(worker->lock);
+            if (!worker->tasks.empty()) {
+                task = worker->tasks.front();
+                worker->tasks.pop_front();
+                return true;
+            }
+        }
+
+        // steal from the back, the furthest from what the owner is working on
+        for (size_t i = 1; i < workers.size(); ++i) {
+            auto& worker = workers[(index + i) % workers.size()];
+            std::lock_guard<std::mutex> guard(worker->lock);
+            if (!worker->tasks.empty()) {
+                task = worker->tasks.back();
+                worker->tasks.pop_back();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    // waits for a task while splitting goes on, false once there is none left
+    bool Take(int index, Task& task)
+    {
+        while (!stop) {
+            if (TakeQueued(index, task)) {
+                std::lock_guard<std::mutex> guard(queue_lock);
+                queued -= 1;
+                queue_changed.notify_all();
+                return true;
+            }
+
+            std::unique_lock<std::mutex> guard(queue_lock);
+            if (queued == 0 && !splitting) {
+                return false;
+            }
+            queue_changed.wait(guard, [this]() {
+                return queued > 0 || !splitting || stop;
+            });
+        }
+        return false;
+    }
+
+    void RunSplit(unsigned int seed)
+    {
+        srand(seed);
+        bool searching = true;
+        while (!stop && searching) {
+            long long nodes = 0;
+            searching = splitter->Run(PUBLISH_STEPS, 0, nodes);
+            steps += nodes;
+            std::lock_guard<std::mutex> guard(lock);
+            split_progress.Clear();
+            split_progress.Merge(splitter->GetStats());
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(queue_lock);
+            splitting = false;
+            queue_changed.notify_all();
+        }
+        running -= 1;
+    }
+
+    void Run(int index, unsigned int seed)
+    {
+        srand(seed);
+        auto& worker = workers[index];
+
+        // one solver for all tasks of the worker, each replaces the previous one
+        PuzzleDef def = *board.GetPuzzleDef();
+        Board local(&def);
+        std::unique_ptr<Solver> created;
+        Task task;
+        while (!stop && Take(index, task)) {
+            bool first = !created;
+            if (first) {
+                created.reset(new Solver(local, nullptr, find_all, rotations_file, engine));
+            }
+            Solver& solver = *created;
+            if (!solver.Replay(task)) {
+                throw std::exception("Subtree does not belong to this search!");
+            }
+            if (first) {
+                solver.RegisterOnSolve(&forward_solve);
+                solver.RegisterOnNewBest(&forward_new_best);
+                if (setup) {
+                    setup(solver);
+                }
+            }
+
+            long long count = 0;
+            bool searching = true;
+            while (!stop && searching) {
+                long long nodes = 0;
+                searching = solver.Run(PUBLISH_STEPS - count, 0, nodes);
+                count += nodes;
+                if (count == PUBLISH_STEPS) {
+                    steps += count;
+                    count = 0;
+                    std::lock_guard<std::mutex> guard(lock);
+                    worker->progress.Clear();
+                    worker->progress.Merge(solver.GetStats());
+                }
+            }
+            steps += count;
+
+            std::lock_guard<std::mutex> guard(lock);
+            worker->progress.Clear();
+            done.Merge(solver.GetStats());
+        }
+
+        running -= 1;
+    }
+
+    Board& board;
+    bool find_all;
+    std::string rotations_file;
+    CandidateEngine engine;
+    int split_depth;
+
+    std::mutex lock; // guards callbacks and statistics below
+    int best_score;
+    Stats stats;
+    Stats done; // explored in finished subtrees
+    Stats split_progress; // explored by splitting so far
+    std::unique_ptr<Solver> splitter;
+    std::thread split_thread;
+    std::atomic<long long> steps;
+    std::atomic<int> running;
+    std::atomic<bool> stop;
+
+    std::mutex queue_lock; // guards the counts below, tasks are guarded by their workers
+    std::condition_variable queue_changed;
+    int queued; // tasks waiting in all workers
+    bool splitting;
+
+    std::vector< std::unique_ptr<Worker> > workers;
+
+    Forward forward_solve;
+    Forward forward_new_best;
+    Split split;
+
+    std::vector< CallbackOnSolve* > on_solve;
+    std::vector< CallbackOnSolve* > on_new_best;
+    std::function<void(Solver&)> setup;
+
+};
+
+}
+
+}
@@ -119,4 +119,9 @@ const std::map<int, PieceDef>& PuzzleDef::GetAll() const
 const std::vector<HintDef>& PuzzleDef::GetHints() const
 {
     return hints;
+}
+
+void PuzzleDef::AddHint(const HintDef& hint)
+{
+    hints.push_back(hint);
 }
\ No newline at end of file
@@ -37,6 +37,9 @@ public:
 
     const std::vector<HintDef>& GetHints() const;
 
+    // must be called before any Board is created for this definition
+    void AddHint(const HintDef& hint);
+
 private:
     int height, width;
     std::vector<PieceDef> corners, edges, inner;
@@ -2,6 +2,33 @@
 
 using namespace edge::backtracker;
 
+Stats::Stats() : initialized(false)
+{
+}
+
+Stats::~Stats()
+{
+    if (!initialized) {
+        return;
+    }
+
+    for (auto& val : factorial) {
+        mpz_clear(val);
+        delete val;
+    }
+    for (auto& item : weights) {
+        mpz_clear(item.second);
+        delete item.second;
+    }
+    for (auto& val : explored) {
+        mpz_clear(val);
+        delete val;
+    }
+    mpz_clear(explored_max);
+    mpz_clear(absLast);
+    mpz_clear(handed_off);
+}
+
 void Stats::Init(Board& board)
 {
     // pre-calculated factorials, 4 times for each rotation
@@ -21,6 +48,10 @@ void Stats::Init(Board& board)
         mpz_init(val);
         mpz_set_ui(val, 0);
     }
+    pending.resize(explored.size());
+    for (auto& level : pending) {
+        level.used = 0;
+    }
 
     int placeable_corners = 4;
     int placeable_edges = static_cast<int>(board.GetPuzzleDef()->GetEdges().size());
@@ -57,49 +88,114 @@ void Stats::Init(Board& board)
 
     mpz_init(absLast);
     mpz_set_ui(absLast, 0);
+    mpz_init(handed_off);
+    mpz_set_ui(handed_off, 0);
+    initialized = true;
 
     // unplaced count, needed for explored statistics 
     unplaced_corners_ids_count = placeable_corners;
     unplaced_edges_ids_count = static_cast<int>(placeable_edges);
     unplaced_inner_ids_count = static_cast<int>(placeable_inners);
+    max_edges = placeable_edges;
+    max_inners = placeable_inners;
 }
 
 void Stats::Update(int stack_pos)
 {
-    mpz_t val;
-    mpz_init(val);
-    mpz_set_ui(val, 1);
-    mpz_mul(val,
-        val, factorial[unplaced_corners_ids_count]);
-    mpz_mul(val,
-        val, factorial[unplaced_edges_ids_count]);
-    mpz_mul(val,
-        val, factorial[unplaced_inner_ids_count]);
-    mpz_t power;
-    mpz_init(power);
-    mpz_set_ui(power, 4);
-    mpz_pow_ui(power, power, unplaced_inner_ids_count);
-    mpz_mul(val,
-        val, power);
-    mpz_add(explored[stack_pos - 1],
-        explored[stack_pos - 1], val);
-    mpz_clear(val);
-    mpz_clear(power);
+    // only counted here, weights are added once the value is needed
+    int state = State();
+    auto& level = pending[stack_pos - 1];
+    int slot = 0;
+    while (slot < level.used && level.state[slot] != state) {
+        ++slot;
+    }
+    if (slot == PENDING_SLOTS) {
+        Fold(stack_pos - 1);
+        slot = 0;
+    }
+    if (slot == level.used) {
+        level.state[slot] = state;
+        level.count[slot] = 0;
+        level.used += 1;
+    }
+    level.count[slot] += 1;
 
     if (explored.size() > stack_pos) {
         mpz_set_ui(explored[stack_pos], 0);
+        pending[stack_pos].used = 0;
     }
 }
 
-MpfWrapper Stats::GetExploredAbs()
+void Stats::HandOff()
 {
-    // sum 
+    mpz_add(handed_off, handed_off, Weight(State()));
+}
+
+void Stats::Merge(const Stats& other)
+{
+    // explored[0] is never reset by Update
     mpz_t sum;
     mpz_init(sum);
-    mpz_set_ui(sum, 0);
+    other.Sum(sum);
+    mpz_add(explored[0], explored[0], sum);
+    mpz_clear(sum);
+}
+
+void Stats::Merge(const std::string& explored)
+{
+    mpz_t val;
+    mpz_init_set_str(val, explored.c_str(), 10);
+    mpz_add(this->explored[0], this->explored[0], val);
+    mpz_clear(val);
+}
+
+void Stats::Clear()
+{
     for (auto& val : explored) {
-        mpz_add(sum, sum, val);
+        mpz_set_ui(val, 0);
     }
+    for (auto& level : pending) {
+        level.used = 0;
+    }
+    mpz_set_ui(handed_off, 0);
+}
+
+void Stats::Save(Checkpoint& checkpoint)
+{
+    for (int level = 0; level < static_cast<int>(pending.size()); ++level) {
+        Fold(level);
+    }
+    checkpoint.Put(static_cast<int64_t>(explored.size()));
+    for (auto& val : explored) {
+        checkpoint.Put(val);
+    }
+    checkpoint.Put(absLast);
+    checkpoint.Put(handed_off);
+}
+
+bool Stats::Load(Checkpoint& checkpoint)
+{
+    if (checkpoint.GetInt() != static_cast<int64_t>(explored.size())) {
+        // different puzzle
+        return false;
+    }
+    for (auto& val : explored) {
+        checkpoint.Get(val);
+    }
+    for (auto& level : pending) {
+        level.used = 0;
+    }
+    checkpoint.Get(absLast);
+    checkpoint.Get(handed_off);
+    return checkpoint.IsValid();
+}
+
+MpfWrapper Stats::GetExploredAbs()
+{
+    // sum 
+    mpz_t sum;
+    mpz_init(sum);
+    Sum(sum);
 
     mpf_t tmp_float;
     mpf_init(tmp_float);
@@ -113,15 +209,23 @@ MpfWrapper Stats::GetExploredAbs()
     return ret;
 }
 
+void Stats::GetExploredAbsExact(std::string& out)
+{
+    mpz_t sum;
+    mpz_init(sum);
+    Sum(sum);
+    std::vector<char> buffer(mpz_sizeinbase(sum, 10) + 2);
+    mpz_get_str(buffer.data(), 10, sum);
+    out = buffer.data();
+    mpz_clear(sum);
+}
+
 MpfWrapper Stats::GetExploredAbsLast()
 {
     // sum 
     mpz_t sum;
     mpz_init(sum);
-    mpz_set_ui(sum, 0);
-    for (auto& val : explored) {
-        mpz_add(sum, sum, val);
-    }
+    Sum(sum);
 
     mpz_t diff;
     mpz_init(diff);
@@ -161,10 +265,7 @@ MpfWrapper Stats::GetExploredRatio()
     // sum 
     mpz_t sum;
     mpz_init(sum);
-    mpz_set_ui(sum, 0);
-    for (auto& val : explored) {
-        mpz_add(sum, sum, val);
-    }
+    Sum(sum);
 
     mpf_t tmp_float1, tmp_float2;
     mpf_init(tmp_float1);
@@ -195,4 +296,65 @@ void Stats::UpdateUnplacedEdges(int amount)
 void Stats::UpdateUnplacedInner(int amount)
 {
     unplaced_inner_ids_count += amount;
+}
+
+int Stats::State() const
+{
+    return (unplaced_corners_ids_count * (max_edges + 1) + unplaced_edges_ids_count) * (max_inners + 1) +
+        unplaced_inner_ids_count;
+}
+
+mpz_srcptr Stats::Weight(int state) const
+{
+    auto& weight = weights[state];
+    if (!weight) {
+        int inners = state % (max_inners + 1);
+        int edges = (state / (max_inners + 1)) % (max_edges + 1);
+        int corners = state / (max_inners + 1) / (max_edges + 1);
+
+        // corners! * edges! * inners! * 4^inners
+        weight = new mpz_t;
+        mpz_init(weight);
+        mpz_mul(weight, factorial[corners], factorial[edges]);
+        mpz_mul(weight, weight, factorial[inners]);
+        mpz_mul_2exp(weight, weight, 2 * inners);
+    }
+    return weight;
+}
+
+static void AddMul(mpz_ptr out, mpz_srcptr val, uint64_t count)
+{
+    // unsigned long may be only 32 bits wide
+    if (count <= 0xffffffffu) {
+        mpz_addmul_ui(out, val, static_cast<unsigned long>(count));
+    }
+    else {
+        mpz_t tmp;
+        mpz_init(tmp);
+        mpz_import(tmp, 1, 1, sizeof(count), 0, 0, &count);
+        mpz_mul(tmp, tmp, val);
+        mpz_add(out, out, tmp);
+        mpz_clear(tmp);
+    }
+}
+
+void Stats::Fold(int level)
+{
+    auto& counts = pending[level];
+    for (int slot = 0; slot < counts.used; ++slot) {
+        AddMul(explored[level], Weight(counts.state[slot]), counts.count[slot]);
+    }
+    counts.used = 0;
+}
+
+void Stats::Sum(mpz_t out) const
+{
+    mpz_set_ui(out, 0);
+    for (size_t level = 0; level < explored.size(); ++level) {
+        mpz_add(out, out, explored[level]);
+        for (int slot = 0; slot < pending[level].used; ++slot) {
+            AddMul(out, Weight(pending[level].state[slot]), pending[level].count[slot]);
+        }
+    }
+    mpz_sub(out, out, handed_off);
 }
\ No newline at end of file
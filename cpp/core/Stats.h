@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <map>
 #include "Board.h"
+#include "Checkpoint.h"
 #include "MpfWrapper.h"
 
 namespace edge {
@@ -9,13 +12,41 @@ namespace backtracker {
 
 class Stats {
 public:
+    Stats();
+
+    ~Stats();
+
+    Stats(const Stats& other) = delete;
+
+    Stats& operator=(const Stats& other) = delete;
 
     void Init(Board& board);
 
     void Update(int stack_pos);
 
+    // subtree of current position is searched elsewhere, it will not be
+    // counted here even once it is covered by backtracking
+    void HandOff();
+
+    // adds space explored by other search (e.g. of handed off subtree)
+    void Merge(const Stats& other);
+
+    // same as above, with exact value obtained by GetExploredAbsExact
+    void Merge(const std::string& explored);
+
+    // forgets all explored space, but keeps last absolute value
+    void Clear();
+
+    // explored space only, unplaced counts follow the restored placements
+    void Save(Checkpoint& checkpoint);
+
+    bool Load(Checkpoint& checkpoint);
+
     MpfWrapper GetExploredAbs();
 
+    // exact decimal value, unlike the floating point getters
+    void GetExploredAbsExact(std::string& out);
+
     MpfWrapper GetExploredAbsLast();
 
     MpfWrapper GetExploredMax();
@@ -29,13 +60,37 @@ public:
     void UpdateUnplacedInner(int amount);
 
 private:
+    static const int PENDING_SLOTS = 3; // children differ by type of piece removed
+
+    // backtracks not yet added to explored, counted by remaining state
+    struct Pending {
+        int state[PENDING_SLOTS];
+        uint64_t count[PENDING_SLOTS];
+        int used;
+    };
+
+    int State() const;
+
+    // number of ways to finish from given remaining state
+    mpz_srcptr Weight(int state) const;
+
+    void Fold(int level);
+
+    void Sum(mpz_t out) const;
+
     std::vector<mpz_ptr> factorial;
+    mutable std::map<int, mpz_ptr> weights; // by state, computed on first use
     std::vector<mpz_ptr> explored;
+    std::vector<Pending> pending; // per level, as explored
     mpz_t explored_max;
     mpz_t absLast;
+    mpz_t handed_off;
+    bool initialized;
     int unplaced_corners_ids_count;
     int unplaced_edges_ids_count;
     int unplaced_inner_ids_count;
+    int max_edges; // bounds of unplaced counts, for state encoding
+    int max_inners;
 
 };
 
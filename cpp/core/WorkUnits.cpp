@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include "WorkUnits.h"
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <dirent.h>
+#endif
+
+using namespace edge::backtracker;
+
+static bool EndsWith(const std::string& val, const std::string& suffix)
+{
+    return val.size() >= suffix.size() &&
+        val.compare(val.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+WorkResult::WorkResult() : nodes(0), best_score(0), solutions(0), explored("0")
+{
+}
+
+WorkUnits::WorkUnits(const std::string& dir, const std::string& owner)
+    : dir(dir), owner(owner), next(0)
+{
+}
+
+void WorkUnits::Add(Board& board)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "unit_%08i.csv", next++);
+
+    // written under temporary name first, so that nobody claims it half written
+    std::string path = Path(name);
+    {
+        std::ofstream file(path + ".tmp");
+        if (!file) {
+            throw std::exception("Unable to write work unit!");
+        }
+        for (int x = 0; x < board.GetPuzzleDef()->GetHeight(); ++x) {
+            for (int y = 0; y < board.GetPuzzleDef()->GetWidth(); ++y) {
+                auto loc = board.GetLocation(x, y);
+                if (loc->ref && !loc->hint) {
+                    file << x << "," << y << "," << loc->ref->GetId() << "," << loc->ref->GetDir() << std::endl;
+                }
+            }
+        }
+    }
+    std::remove(path.c_str());
+    std::rename((path + ".tmp").c_str(), path.c_str());
+}
+
+bool WorkUnits::Claim(std::string& name, std::vector<HintDef>& placements)
+{
+    std::string own = ".csv." + owner;
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        if (pending.empty()) {
+            // processes sharing the directory try units in different order
+            for (auto& file : List()) {
+                if (EndsWith(file, own)) {
+                    // claimed before this owner was interrupted, continue it first
+                    // (unless only the claim was left behind)
+                    std::string unit = file.substr(0, file.size() - own.size());
+                    if (std::ifstream(Path(unit + ".result"))) {
+                        std::remove(Path(file).c_str());
+                        continue;
+                    }
+                    pending.clear();
+                    name = unit;
+                    Read(Path(file), placements);
+                    return true;
+                }
+                if (EndsWith(file, ".csv")) {
+                    pending.push_back(file);
+                }
+            }
+            std::random_shuffle(pending.begin(), pending.end());
+        }
+
+        while (!pending.empty()) {
+            std::string file = pending.back();
+            pending.pop_back();
+
+            std::string claimed = Path(file) + "." + owner;
+            if (std::rename(Path(file).c_str(), claimed.c_str()) != 0) {
+                // somebody else was faster
+                continue;
+            }
+
+            name = file.substr(0, file.size() - 4);
+            Read(claimed, placements);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void WorkUnits::Finish(const std::string& name, const WorkResult& result)
+{
+    std::string path = Path(name + ".result");
+    {
+        std::ofstream file(path + ".tmp");
+        file << result.nodes << "," << result.best_score << ","
+            << result.solutions << "," << result.explored << std::endl;
+    }
+    std::remove(path.c_str());
+    std::rename((path + ".tmp").c_str(), path.c_str());
+    std::remove((Path(name + ".csv") + "." + owner).c_str());
+}
+
+void WorkUnits::Collect(std::vector<WorkResult>& results, int& waiting, std::vector<std::string>& unfinished)
+{
+    results.clear();
+    waiting = 0;
+    unfinished.clear();
+    auto files = List();
+    for (auto& file : files) {
+        if (EndsWith(file, ".csv")) {
+            waiting += 1;
+        }
+        else if (EndsWith(file, ".result")) {
+            std::ifstream in(Path(file));
+            std::string line;
+            if (getline(in, line)) {
+                std::vector<std::string> vals;
+                std::string val;
+                std::stringstream ss(line);
+                while (getline(ss, val, ',')) {
+                    vals.push_back(val);
+                }
+                if (vals.size() == 4) {
+                    WorkResult result;
+                    result.nodes = std::stoll(vals[0]);
+                    result.best_score = std::stoi(vals[1]);
+                    result.solutions = std::stoi(vals[2]);
+                    result.explored = vals[3];
+                    results.push_back(result);
+                }
+            }
+        }
+        else if (file.find(".csv.") != std::string::npos && !EndsWith(file, ".tmp")) {
+            // result may be already stored when its owner stopped right after
+            std::string result = file.substr(0, file.find(".csv.")) + ".result";
+            if (!std::binary_search(files.begin(), files.end(), result)) {
+                unfinished.push_back(file);
+            }
+        }
+    }
+}
+
+int WorkUnits::Requeue()
+{
+    int count = 0;
+    for (auto& file : List()) {
+        size_t pos = file.find(".csv.");
+        if (pos == std::string::npos || EndsWith(file, ".tmp")) {
+            continue;
+        }
+
+        std::string waiting = Path(file.substr(0, pos + 4));
+        std::string result = Path(file.substr(0, pos) + ".result");
+        if (std::ifstream(result)) {
+            // finished, only the claim was left behind
+            std::remove(Path(file).c_str());
+        }
+        else if (std::rename(Path(file).c_str(), waiting.c_str()) == 0) {
+            count += 1;
+        }
+    }
+    return count;
+}
+
+std::vector<std::string> WorkUnits::List()
+{
+    std::vector<std::string> files;
+#ifdef _WIN32
+    WIN32_FIND_DATAA data;
+    HANDLE handle = FindFirstFileA(Path("*").c_str(), &data);
+    if (handle != INVALID_HANDLE_VALUE) {
+        do {
+            files.push_back(data.cFileName);
+        } while (FindNextFileA(handle, &data));
+        FindClose(handle);
+    }
+#else
+    DIR* handle = opendir(dir.c_str());
+    if (handle) {
+        while (auto entry = readdir(handle)) {
+            files.push_back(entry->d_name);
+        }
+        closedir(handle);
+    }
+#endif
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+void WorkUnits::Read(const std::string& file, std::vector<HintDef>& placements)
+{
+    placements.clear();
+    std::ifstream unit(file);
+    std::string line;
+    std::vector<int> vals;
+    while (getline(unit, line)) {
+        vals.clear();
+        ParseNumberLine(line, vals);
+        if (vals.size() == 4) {
+            placements.push_back(HintDef(vals[0], vals[1], vals[2], vals[3]));
+        }
+    }
+}
+
+std::string WorkUnits::Path(const std::string& file) const
+{
+    return dir + "/" + file;
+}
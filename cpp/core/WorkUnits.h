@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Board.h"
+
+namespace edge {
+
+namespace backtracker {
+
+struct WorkResult {
+    WorkResult();
+
+    long long nodes;
+    int best_score;
+    int solutions;
+    std::string explored; // exact decimal value
+};
+
+// Work units stored as files in directory shared by any number of processes
+// (on any number of machines). Each unit is a placement prefix in hints file
+// format, it is claimed by renaming it, which succeeds for one process only.
+//   unit_N.csv          waiting
+//   unit_N.csv.OWNER    claimed by OWNER
+//   unit_N.result       finished, nodes,best_score,solutions,explored
+// Units claimed by a process which did not finish are continued by the next
+// process of the same owner, or made waiting again by Requeue.
+class WorkUnits {
+public:
+    // owner - name of this process, unique among the ones running at once and
+    // kept when the process is restarted
+    WorkUnits(const std::string& dir, const std::string& owner);
+
+    // stores pieces placed on the board (except hints) as new unit
+    void Add(Board& board);
+
+    // continues unit claimed by the same owner before or claims any waiting
+    // unit, returns false if there is none left
+    bool Claim(std::string& name, std::vector<HintDef>& placements);
+
+    // stores result of claimed unit (or of work done outside of units)
+    void Finish(const std::string& name, const WorkResult& result);
+
+    // unfinished - claimed units without result (as unit_N.csv.OWNER)
+    void Collect(std::vector<WorkResult>& results, int& waiting, std::vector<std::string>& unfinished);
+
+    // makes all claimed units waiting again, to be used only while no process
+    // is solving them, returns number of units requeued
+    int Requeue();
+
+private:
+    std::vector<std::string> List();
+
+    // reads placements of claimed unit file
+    void Read(const std::string& file, std::vector<HintDef>& placements);
+
+    std::string Path(const std::string& file) const;
+
+    std::string dir;
+    std::string owner;
+    int next;
+    std::vector<std::string> pending; // waiting units seen by last listing
+
+};
+
+}
+
+}
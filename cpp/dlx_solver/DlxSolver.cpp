@@ -0,0 +1,410 @@
+#include <climits>
+#include <fstream>
+#include <map>
+#include "DlxSolver.h"
+
+using namespace edge::backtracker;
+
+DlxSolver::DlxSolver(Board& board, bool find_all, const std::string& rotations_file)
+    : board(board), state(State::CHOOSING), find_all(find_all), level(0), reported(false)
+{
+    auto def = board.GetPuzzleDef();
+    int height = def->GetHeight();
+    int width = def->GetWidth();
+    int pieces = def->GetPieceCount();
+
+    std::map<int, int> rotations;
+    if (!rotations_file.empty()) {
+        std::ifstream file(rotations_file);
+        std::string line;
+        std::vector<int> vals;
+
+        while (getline(file, line)) {
+            vals.clear();
+            ParseNumberLine(line, vals);
+            vals.resize(2, 0);
+            rotations[vals[0]] = vals[1];
+        }
+    }
+
+    // hints
+    std::map< std::pair<int, int>, const HintDef* > hints;
+    std::vector<bool> hinted(pieces + 1, false);
+    for (auto& hint : def->GetHints()) {
+        int dir = (hint.dir != -1) ? hint.dir : 0;
+        board.PutPiece(hint.id, hint.x, hint.y, dir);
+        hints[std::pair<int, int>(hint.x, hint.y)] = &hint;
+        hinted[hint.id] = true;
+    }
+
+    // locations, then pieces, then horizontal and vertical edges
+    primary = height * width + pieces;
+    int horizontal = primary + 1;
+    int vertical = horizontal + height * (width - 1);
+    items = vertical + (height - 1) * width - 1;
+
+    llink.resize(items + 2);
+    rlink.resize(items + 2);
+    for (int i = 0; i <= primary; ++i) {
+        rlink[i] = (i + 1) % (primary + 1);
+        llink[(i + 1) % (primary + 1)] = i;
+    }
+    int secondary_head = items + 1;
+    int last = secondary_head;
+    for (int i = primary + 1; i <= items; ++i) {
+        rlink[last] = i;
+        llink[i] = last;
+        last = i;
+    }
+    rlink[last] = secondary_head;
+    llink[secondary_head] = last;
+
+    // headers, then the first spacer
+    top.assign(items + 2, 0);
+    color.assign(items + 2, 0);
+    ulink.resize(items + 2);
+    dlink.resize(items + 2);
+    for (int i = 0; i <= items + 1; ++i) {
+        ulink[i] = i;
+        dlink[i] = i;
+    }
+
+    std::vector< std::pair<int, int> > option_items;
+    for (int x = 0; x < height; ++x) {
+        for (int y = 0; y < width; ++y) {
+            bool outside[4] = { y == width - 1, x == height - 1, y == 0, x == 0 };
+            int edges[4] = {
+                horizontal + x * (width - 1) + y,
+                vertical + x * width + y,
+                horizontal + x * (width - 1) + y - 1,
+                vertical + (x - 1) * width + y
+            };
+
+            auto hint = hints.find(std::pair<int, int>(x, y));
+            for (int id = 1; id <= pieces; ++id) {
+                if (hint != hints.end() ? id != hint->second->id : hinted[id]) {
+                    continue;
+                }
+                for (int dir = 0; dir < 4; ++dir) {
+                    if (hint != hints.end()) {
+                        if (dir != ((hint->second->dir != -1) ? hint->second->dir : 0)) {
+                            continue;
+                        }
+                    }
+                    else if (!rotations.empty() && rotations[id] != dir) {
+                        continue;
+                    }
+
+                    auto ref = board.GetRef(id, dir);
+                    bool fits = true;
+                    for (int side = 0; side < 4; ++side) {
+                        fits = fits && ((ref->GetPattern(side) == 0) == outside[side]);
+                    }
+                    if (!fits && hint == hints.end()) {
+                        continue;
+                    }
+
+                    option_items.clear();
+                    option_items.push_back(std::pair<int, int>(1 + x * width + y, 0));
+                    option_items.push_back(std::pair<int, int>(height * width + id, 0));
+                    for (int side = 0; side < 4; ++side) {
+                        if (!outside[side]) {
+                            option_items.push_back(std::pair<int, int>(edges[side], ref->GetPattern(side)));
+                        }
+                    }
+                    AddOption(Option{ id, dir, x, y }, option_items);
+                }
+            }
+        }
+    }
+
+    chosen.resize(primary + 1);
+    covered.resize(primary + 1);
+    highest_level = static_cast<int>(def->GetHints().size());
+}
+
+bool DlxSolver::Step()
+{
+    switch (state)
+    {
+    case State::CHOOSING: {
+        if (rlink[0] == 0) {
+            // all locations and pieces covered
+            Report(on_solve);
+            reported = true;
+            if (!find_all) {
+                state = State::FINISHED;
+                return false;
+            }
+            state = State::BACKTRACKING;
+            return true;
+        }
+
+        // item with fewest options left
+        int item = 0;
+        int length = INT_MAX;
+        for (int i = rlink[0]; i != 0; i = rlink[i]) {
+            if (top[i] < length) {
+                item = i;
+                length = top[i];
+                if (length == 0) {
+                    break;
+                }
+            }
+        }
+        if (length == 0) {
+            state = State::BACKTRACKING;
+            return true;
+        }
+
+        Cover(item);
+        covered[level] = item;
+        chosen[level] = dlink[item];
+        state = State::TRYING;
+        return true;
+    }
+    case State::TRYING: {
+        int node = chosen[level];
+        if (node == covered[level]) {
+            // all options of the item tried
+            Uncover(node);
+            state = State::BACKTRACKING;
+            return true;
+        }
+
+        for (int p = node + 1; p != node;) {
+            if (top[p] <= 0) {
+                p = ulink[p];
+            }
+            else {
+                Commit(p);
+                ++p;
+            }
+        }
+        ++level;
+
+        if (level > highest_level) {
+            highest_level = level;
+            Report(on_new_best);
+            reported = true;
+        }
+        state = State::CHOOSING;
+        return true;
+    }
+    case State::BACKTRACKING: {
+        if (level == 0) {
+            state = State::FINISHED;
+            return false;
+        }
+        --level;
+        int node = chosen[level];
+        for (int p = node - 1; p != node;) {
+            if (top[p] <= 0) {
+                p = dlink[p];
+            }
+            else {
+                Uncommit(p);
+                --p;
+            }
+        }
+        chosen[level] = dlink[node];
+        state = State::TRYING;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+bool DlxSolver::Run(long long node_budget, time_t deadline, long long& nodes)
+{
+    nodes = 0;
+    reported = false;
+    while (nodes < node_budget) {
+        if (!Step()) {
+            break;
+        }
+        ++nodes;
+
+        // let the caller react to solution or new best
+        if (reported) {
+            break;
+        }
+
+        if (deadline && nodes % DEADLINE_CHECK_NODES == 0 && time(0) >= deadline) {
+            break;
+        }
+    }
+
+    return state != State::FINISHED;
+}
+
+void DlxSolver::RegisterOnSolve(CallbackOnSolve* callback)
+{
+    on_solve.push_back(callback);
+}
+
+void DlxSolver::RegisterOnNewBest(CallbackOnSolve* callback)
+{
+    on_new_best.push_back(callback);
+}
+
+int DlxSolver::GetOptionCount() const
+{
+    return static_cast<int>(options.size());
+}
+
+int DlxSolver::GetLevel() const
+{
+    return level;
+}
+
+void DlxSolver::AddOption(const Option& option, const std::vector< std::pair<int, int> >& option_items)
+{
+    int spacer = static_cast<int>(top.size()) - 1;
+    int first = spacer + 1;
+    for (auto& item : option_items) {
+        int node = static_cast<int>(top.size());
+        top.push_back(item.first);
+        color.push_back(item.second);
+        ulink.push_back(ulink[item.first]);
+        dlink.push_back(item.first);
+        dlink[ulink[item.first]] = node;
+        ulink[item.first] = node;
+        ++top[item.first];
+    }
+    dlink[spacer] = static_cast<int>(top.size()) - 1;
+
+    options.push_back(option);
+    top.push_back(-static_cast<int>(options.size()));
+    color.push_back(0);
+    ulink.push_back(first);
+    dlink.push_back(static_cast<int>(top.size()) - 1);
+}
+
+void DlxSolver::Cover(int item)
+{
+    for (int p = dlink[item]; p != item; p = dlink[p]) {
+        Hide(p);
+    }
+    rlink[llink[item]] = rlink[item];
+    llink[rlink[item]] = llink[item];
+}
+
+void DlxSolver::Uncover(int item)
+{
+    rlink[llink[item]] = item;
+    llink[rlink[item]] = item;
+    for (int p = ulink[item]; p != item; p = ulink[p]) {
+        Unhide(p);
+    }
+}
+
+void DlxSolver::Hide(int node)
+{
+    // other items of the option, going around through the spacer
+    for (int q = node + 1; q != node;) {
+        int item = top[q];
+        if (item <= 0) {
+            q = ulink[q];
+            continue;
+        }
+        if (color[q] >= 0) {
+            dlink[ulink[q]] = dlink[q];
+            ulink[dlink[q]] = ulink[q];
+            --top[item];
+        }
+        ++q;
+    }
+}
+
+void DlxSolver::Unhide(int node)
+{
+    for (int q = node - 1; q != node;) {
+        int item = top[q];
+        if (item <= 0) {
+            q = dlink[q];
+            continue;
+        }
+        if (color[q] >= 0) {
+            dlink[ulink[q]] = q;
+            ulink[dlink[q]] = q;
+            ++top[item];
+        }
+        --q;
+    }
+}
+
+void DlxSolver::Commit(int node)
+{
+    if (color[node] == 0) {
+        Cover(top[node]);
+    }
+    else if (color[node] > 0) {
+        Purify(node);
+    }
+}
+
+void DlxSolver::Uncommit(int node)
+{
+    if (color[node] == 0) {
+        Uncover(top[node]);
+    }
+    else if (color[node] > 0) {
+        Unpurify(node);
+    }
+}
+
+void DlxSolver::Purify(int node)
+{
+    // options with the same colour stay, marked as already agreeing
+    int c = color[node];
+    int item = top[node];
+    for (int q = dlink[item]; q != item; q = dlink[q]) {
+        if (color[q] != c) {
+            Hide(q);
+        }
+        else if (q != node) {
+            color[q] = -1;
+        }
+    }
+}
+
+void DlxSolver::Unpurify(int node)
+{
+    int c = color[node];
+    int item = top[node];
+    for (int q = ulink[item]; q != item; q = ulink[q]) {
+        if (color[q] < 0) {
+            color[q] = c;
+        }
+        else if (q != node) {
+            Unhide(q);
+        }
+    }
+}
+
+void DlxSolver::Report(std::vector< CallbackOnSolve* >& callbacks)
+{
+    // options end with spacer holding their index
+    std::vector<const Option*> placed;
+    for (int k = 0; k < level; ++k) {
+        int p = chosen[k];
+        while (top[p] > 0) {
+            ++p;
+        }
+        const Option& option = options[-top[p] - 1];
+        if (!board.GetLocation(option.x, option.y)->hint) {
+            board.PutPiece(option.id, option.x, option.y, option.dir);
+            placed.push_back(&option);
+        }
+    }
+
+    for (auto& callback : callbacks) {
+        callback->Call(board);
+    }
+
+    for (auto option : placed) {
+        board.RemovePiece(board.GetLocation(option->x, option->y));
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <ctime>
+#include <string>
+#include <vector>
+#include "Board.h"
+#include "CallbackOnSolve.h"
+
+namespace edge {
+
+namespace backtracker {
+
+// Solves the puzzle as exact cover with colours (Knuth's Algorithm C, dancing
+// links). Primary items are locations and pieces, each to be covered exactly
+// once, secondary items are edges between neighbouring locations, coloured by
+// the pattern placed on them, so that both pieces agree on it. Option is piece
+// in some rotation at some location, with border patterns exactly on the
+// border. Links are indices into arrays of nodes instead of pointers.
+class DlxSolver {
+public:
+    // hints of the definition are placed on the board and get the only option
+    // of their location, rotations file restricts every piece to one rotation
+    DlxSolver(Board& board, bool find_all = false, const std::string& rotations_file = "");
+
+    // chooses item and covers it, tries next option or backtracks, false once
+    // the search is finished
+    bool Step();
+
+    // runs steps until node_budget is spent, deadline (as returned by time,
+    // 0 for none) passes, solution or new best is found or the search ends,
+    // number of steps done is stored in nodes, returns false once finished
+    bool Run(long long node_budget, time_t deadline, long long& nodes);
+
+    void RegisterOnSolve(CallbackOnSolve* callback);
+
+    void RegisterOnNewBest(CallbackOnSolve* callback);
+
+    // number of options in the matrix
+    int GetOptionCount() const;
+
+    // number of chosen options
+    int GetLevel() const;
+
+private:
+    static const int DEADLINE_CHECK_NODES = 0x1000; // how often Run checks the time
+
+    enum class State {
+        CHOOSING = 0, // item to cover at the next level
+        TRYING = 1, // next option of covered item
+        BACKTRACKING = 2,
+        FINISHED = 3
+    };
+
+    struct Option {
+        int id, dir, x, y;
+    };
+
+    void AddOption(const Option& option, const std::vector< std::pair<int, int> >& items);
+
+    void Cover(int item);
+
+    void Uncover(int item);
+
+    void Hide(int node);
+
+    void Unhide(int node);
+
+    void Commit(int node);
+
+    void Uncommit(int node);
+
+    void Purify(int node);
+
+    void Unpurify(int node);
+
+    // places options chosen so far on the board and calls the callbacks
+    void Report(std::vector< CallbackOnSolve* >& callbacks);
+
+    Board& board;
+    State state;
+    bool find_all;
+
+    // items 1 .. primary are in list starting at 0, secondary ones in list
+    // starting at items + 1, one header node per item with the same index
+    int primary;
+    int items;
+    std::vector< int > llink, rlink; // of items
+    std::vector< int > top; // item of node, length for header, -option for spacer
+    std::vector< int > ulink, dlink; // spacer has first node of previous option and last of next one
+    std::vector< int > color; // 0 if none, -1 if already purified
+    std::vector< Option > options;
+
+    std::vector< int > chosen; // node of option tried at each level
+    std::vector< int > covered; // item covered at each level
+    int level;
+    int highest_level;
+    bool reported; // solution or new best found in current Run
+
+    std::vector< CallbackOnSolve* > on_solve;
+    std::vector< CallbackOnSolve* > on_new_best;
+
+};
+
+}
+
+}
@@ -0,0 +1,133 @@
+#include <sstream>
+#include "PuzzleDef.h"
+#include "Board.h"
+#include "DlxSolver.h"
+#include "Args.h"
+#include <time.h>
+#include <Windows.h>
+
+class NewBest : public edge::backtracker::CallbackOnSolve {
+public:
+    NewBest(const std::string& prefix) : max_score(0), prefix(prefix)
+    {
+    }
+
+    void Call(edge::Board& board)
+    {
+        int score = board.GetScore();
+        if (score > max_score) {
+            max_score = score;
+        }
+        printf("New best backstack position reached, score: %i\n", score);
+        if (score > 330/*420*/) {
+            std::stringstream ss;
+            try {
+                remove(last_save.c_str());
+            }
+            catch (...) {
+
+            }
+            ss << prefix << "_dlx_save_" << score << ".csv";
+            last_save = ss.str();
+            board.Save(last_save);
+        }
+    }
+
+    int max_score;
+
+private:
+    std::string prefix;
+    std::string last_save;
+};
+
+class Solved : public edge::backtracker::CallbackOnSolve {
+public:
+    Solved(const std::string& prefix) : prefix(prefix), counter(0)
+    {
+    }
+
+    void Call(edge::Board& board)
+    {
+        printf("SOLVED! (%i)\n", counter + 1);
+        if (counter < 20)
+        {// safety mechanism, do not save more than certain number of solutions...
+            std::stringstream ss;
+            ss << prefix << "_save_" << "solved_" << counter + 1 << ".csv";
+            board.Save(ss.str());
+        }
+        ++counter;
+    }
+
+    int GetCount() const
+    {
+        return counter;
+    }
+
+private:
+    std::string prefix;
+    int counter;
+};
+
+static const long long RUN_NODES = 0x10000; // most steps done between checks of time
+
+int main(int argc, char* argv[])
+{
+    // positional arguments: definition, [hints], [rotations]
+    edge::Args args(argc, argv);
+    auto& positional = args.GetPositional();
+    if (positional.empty()) {
+        printf("Missing puzzle definition argument\n");
+        return 1;
+    }
+
+    std::string def_file = positional[0];
+    std::string hints_file = "";
+    if (positional.size() > 1) {
+        hints_file = positional[1];
+    }
+
+    std::string rotations_file = "";
+    if (positional.size() > 2) {
+        rotations_file = positional[2];
+    }
+
+    std::stringstream ss;
+    ss << (unsigned int)time(0);
+    std::string prefix = ss.str();
+    printf("save_prefix: %s\n", prefix.c_str());
+
+    edge::PuzzleDef def = edge::PuzzleDef::Load(def_file, hints_file);
+    edge::Board board(&def);
+
+    int start_absolute = (int)time(0);
+    Solved solved_callback(prefix);
+    NewBest newbest_callback(prefix);
+    edge::backtracker::DlxSolver solver(board, true, rotations_file);
+    solver.RegisterOnSolve(&solved_callback);
+    solver.RegisterOnNewBest(&newbest_callback);
+    printf("options: %i, built in %i sec\n", solver.GetOptionCount(), (int)time(0) - start_absolute);
+
+    long long total = 0;
+    long long last_total = 0;
+    int start = (int)time(0);
+    bool keep_going = true;
+    while (keep_going) {
+        long long nodes = 0;
+        keep_going = solver.Run(RUN_NODES, start + 1, nodes);
+        total += nodes;
+
+        int now = (int)time(0);
+        if (now - start >= 1) {
+            printf("max_score: %i, level: %i, solutions: %i, iters: %lli (+%lli)\n",
+                newbest_callback.max_score, solver.GetLevel(), solved_callback.GetCount(), total, total - last_total);
+            Sleep(10);
+            last_total = total;
+            start = now;
+        }
+    }
+
+    printf("finished in %i sec\n", (int)time(0) - start_absolute);
+    printf("max_score: %i, solutions: %i, iters: %lli\n", newbest_callback.max_score, solved_callback.GetCount(), total);
+
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include "MacroBacktracker.h"
+
+using namespace edge::backtracker;
+
+MacroBacktracker::MacroBacktracker(Board& board, const TileTable& tiles)
+    : board(board), tiles(tiles), depth(0), finished(false), reported(false)
+{
+    auto def = board.GetPuzzleDef();
+    block_width = tiles.GetBlockWidth();
+    levels.resize(tiles.GetBlockHeight() * block_width + 1);
+    used.assign(def->GetPieceCount() / 64 + 1, 0);
+
+    // hints
+    hinted.assign(def->GetHeight() * def->GetWidth(), false);
+    for (auto& hint : def->GetHints()) {
+        int dir = (hint.dir != -1) ? hint.dir : 0;
+        board.PutPiece(hint.id, hint.x, hint.y, dir);
+        hinted[hint.x * def->GetWidth() + hint.y] = true;
+    }
+    pieces = static_cast<int>(def->GetHints().size());
+    highest_score = pieces;
+
+    Open();
+}
+
+bool MacroBacktracker::Step()
+{
+    if (finished) {
+        return false;
+    }
+
+    Level& level = levels[depth];
+    while (level.next != level.end && !IsFree(*level.next)) {
+        ++level.next;
+    }
+
+    if (level.next == level.end) {
+        // all tiles tried, back to previous block
+        if (depth == 0) {
+            finished = true;
+            return false;
+        }
+        Remove();
+        return true;
+    }
+
+    Place(*level.next++);
+    if (pieces > highest_score) {
+        highest_score = pieces;
+        reported = true;
+        for (auto& callback : on_new_best) {
+            callback->Call(board);
+        }
+    }
+
+    if (depth + 1 == static_cast<int>(levels.size())) {
+        reported = true;
+        for (auto& callback : on_solve) {
+            callback->Call(board);
+        }
+        // continue with other solutions
+        Remove();
+        return true;
+    }
+
+    Open();
+    return true;
+}
+
+bool MacroBacktracker::Run(long long node_budget, time_t deadline, long long& nodes)
+{
+    nodes = 0;
+    reported = false;
+    while (nodes < node_budget) {
+        if (!Step()) {
+            break;
+        }
+        ++nodes;
+
+        // let the caller react to solution or new best
+        if (reported) {
+            break;
+        }
+
+        if (deadline && nodes % DEADLINE_CHECK_NODES == 0 && time(0) >= deadline) {
+            break;
+        }
+    }
+
+    return !finished;
+}
+
+void MacroBacktracker::RegisterOnSolve(CallbackOnSolve* callback)
+{
+    on_solve.push_back(callback);
+}
+
+void MacroBacktracker::RegisterOnNewBest(CallbackOnSolve* callback)
+{
+    on_new_best.push_back(callback);
+}
+
+int MacroBacktracker::GetDepth() const
+{
+    return depth;
+}
+
+inline bool MacroBacktracker::IsFree(const TileTable::Tile& tile) const
+{
+    uint64_t taken = 0;
+    for (int cell = 0; cell < 4; ++cell) {
+        taken |= used[tile.ids[cell] / 64] & (1ull << (tile.ids[cell] % 64));
+    }
+    return taken == 0;
+}
+
+void MacroBacktracker::Place(const TileTable::Tile& tile)
+{
+    int width = board.GetPuzzleDef()->GetWidth();
+    int bx = depth / block_width;
+    int by = depth % block_width;
+    for (int cell = 0; cell < 4; ++cell) {
+        int x = 2 * bx + cell / 2;
+        int y = 2 * by + cell % 2;
+        used[tile.ids[cell] / 64] |= 1ull << (tile.ids[cell] % 64);
+        if (!hinted[x * width + y]) {
+            board.PutPiece(tile.ids[cell], x, y, tile.GetDir(cell));
+            ++pieces;
+        }
+    }
+    ++depth;
+}
+
+void MacroBacktracker::Remove()
+{
+    --depth;
+    int width = board.GetPuzzleDef()->GetWidth();
+    const TileTable::Tile& tile = *(levels[depth].next - 1);
+    int bx = depth / block_width;
+    int by = depth % block_width;
+    for (int cell = 0; cell < 4; ++cell) {
+        int x = 2 * bx + cell / 2;
+        int y = 2 * by + cell % 2;
+        used[tile.ids[cell] / 64] &= ~(1ull << (tile.ids[cell] % 64));
+        if (!hinted[x * width + y]) {
+            board.RemovePiece(board.GetLocation(x, y));
+            --pieces;
+        }
+    }
+}
+
+void MacroBacktracker::Open()
+{
+    // frame holds piece with all patterns 0
+    int bx = depth / block_width;
+    int by = depth % block_width;
+    int x = 2 * bx;
+    int y = 2 * by;
+    tiles.GetTiles(bx, by,
+        board.GetLocation(x - 1, y)->ref->GetPattern(SOUTH),
+        board.GetLocation(x - 1, y + 1)->ref->GetPattern(SOUTH),
+        board.GetLocation(x, y - 1)->ref->GetPattern(EAST),
+        board.GetLocation(x + 1, y - 1)->ref->GetPattern(EAST),
+        levels[depth].next, levels[depth].end);
+}
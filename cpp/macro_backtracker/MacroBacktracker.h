@@ -0,0 +1,76 @@
+#pragma once
+
+#include <ctime>
+#include <vector>
+#include "Board.h"
+#include "CallbackOnSolve.h"
+#include "TileTable.h"
+
+namespace edge {
+
+namespace backtracker {
+
+// Backtracker over blocks of 2x2 locations in row-major order, every step
+// places a whole tile from precomputed table, so the choices of a block are
+// those of four locations at once, with only the tiles matching patterns of
+// blocks above and to the left. Tiles share no piece with the placed ones,
+// which is checked against bitset of used pieces.
+class MacroBacktracker {
+public:
+    // hints of the definition are placed on the board, they must be in the
+    // tiles as built for the same definition
+    MacroBacktracker(Board& board, const TileTable& tiles);
+
+    // places or removes one tile, false once the search is finished
+    bool Step();
+
+    // runs steps until node_budget is spent, deadline (as returned by time,
+    // 0 for none) passes, solution or new best is found or the search ends,
+    // number of steps done is stored in nodes, returns false once finished
+    bool Run(long long node_budget, time_t deadline, long long& nodes);
+
+    void RegisterOnSolve(CallbackOnSolve* callback);
+
+    void RegisterOnNewBest(CallbackOnSolve* callback);
+
+    // number of placed tiles
+    int GetDepth() const;
+
+private:
+    static const int DEADLINE_CHECK_NODES = 0x1000; // how often Run checks the time
+
+    // tiles of a block still to be tried
+    struct Level {
+        const TileTable::Tile* next;
+        const TileTable::Tile* end;
+    };
+
+    bool IsFree(const TileTable::Tile& tile) const;
+
+    void Place(const TileTable::Tile& tile);
+
+    void Remove();
+
+    // tiles matching placed blocks above and to the left of block at depth
+    void Open();
+
+    Board& board;
+    const TileTable& tiles;
+    int block_width;
+    std::vector< Level > levels; // by depth, i.e. block in row-major order
+    int depth; // number of placed tiles
+    std::vector< uint64_t > used; // by piece id, hints are only in their tiles
+    std::vector< bool > hinted; // by location x * width + y
+    bool finished;
+    int pieces; // on the board, including hints
+    int highest_score;
+    bool reported; // solution or new best found in current Run
+
+    std::vector< CallbackOnSolve* > on_solve;
+    std::vector< CallbackOnSolve* > on_new_best;
+
+};
+
+}
+
+}
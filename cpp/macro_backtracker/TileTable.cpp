@@ -0,0 +1,195 @@
+#include <exception>
+#include <map>
+#include "TileTable.h"
+
+using namespace edge::backtracker;
+
+TileTable::TileTable(const PuzzleDef* def, size_t budget) : def(def), budget(budget), memory(0)
+{
+    if (def->GetHeight() % 2 || def->GetWidth() % 2) {
+        throw std::exception("Tiles need board of even height and width!");
+    }
+    block_height = def->GetHeight() / 2;
+    block_width = def->GetWidth() / 2;
+
+    colors = 1;
+    for (auto& item : def->GetAll()) {
+        for (int i = 0; i < 4; ++i) {
+            colors = std::max(colors, item.second.patterns[i] + 1);
+        }
+    }
+
+    std::set< std::pair<int, int> > hinted_blocks;
+    for (auto& hint : def->GetHints()) {
+        hinted_blocks.insert(std::pair<int, int>(hint.x / 2, hint.y / 2));
+    }
+
+    // blocks without hints share table by the sides they have on the border
+    std::map<int, int> shared;
+    block_tables.resize(block_height * block_width);
+    for (int bx = 0; bx < block_height; ++bx) {
+        for (int by = 0; by < block_width; ++by) {
+            int kind = (bx == 0 ? 1 : 0) | (bx == block_height - 1 ? 2 : 0) |
+                (by == 0 ? 4 : 0) | (by == block_width - 1 ? 8 : 0);
+            bool hinted = hinted_blocks.count(std::pair<int, int>(bx, by)) != 0;
+            if (!hinted) {
+                auto found = shared.find(kind);
+                if (found != shared.end()) {
+                    block_tables[bx * block_width + by] = found->second;
+                    continue;
+                }
+                shared[kind] = static_cast<int>(tables.size());
+            }
+            block_tables[bx * block_width + by] = static_cast<int>(tables.size());
+            tables.push_back(Table());
+            Build(bx, by, tables.back());
+        }
+    }
+}
+
+int TileTable::GetBlockHeight() const
+{
+    return block_height;
+}
+
+int TileTable::GetBlockWidth() const
+{
+    return block_width;
+}
+
+void TileTable::GetTiles(int bx, int by, int north0, int north1, int west0, int west1,
+    const Tile*& begin, const Tile*& end) const
+{
+    auto& table = tables[block_tables[bx * block_width + by]];
+    int key = Key(north0, north1, west0, west1);
+    begin = table.tiles.data() + table.offsets[key];
+    end = table.tiles.data() + table.offsets[key + 1];
+}
+
+size_t TileTable::GetTileCount() const
+{
+    size_t count = 0;
+    for (auto& table : tables) {
+        count += table.tiles.size();
+    }
+    return count;
+}
+
+size_t TileTable::GetMemory() const
+{
+    return memory;
+}
+
+void TileTable::Build(int bx, int by, Table& table)
+{
+    int height = def->GetHeight();
+    int width = def->GetWidth();
+    std::map< std::pair<int, int>, HintDef > hints;
+    std::vector<bool> hinted(def->GetPieceCount() + 1, false);
+    for (auto& hint : def->GetHints()) {
+        hints.insert(std::make_pair(std::pair<int, int>(hint.x, hint.y), hint));
+        hinted[hint.id] = true;
+    }
+
+    // pieces fitting each cell on their own, border patterns exactly where the
+    // cell is on the border
+    std::vector<PieceRef> allowed[4];
+    for (int cell = 0; cell < 4; ++cell) {
+        int x = 2 * bx + cell / 2;
+        int y = 2 * by + cell % 2;
+        auto hint = hints.find(std::pair<int, int>(x, y));
+        if (hint != hints.end()) {
+            int dir = (hint->second.dir != -1) ? hint->second.dir : 0;
+            allowed[cell].push_back(PieceRef(def->GetPieceDef(hint->second.id), dir));
+            continue;
+        }
+        bool outside[4] = { y == width - 1, x == height - 1, y == 0, x == 0 };
+        for (auto& item : def->GetAll()) {
+            if (hinted[item.first]) {
+                continue;
+            }
+            for (int dir = 0; dir < 4; ++dir) {
+                PieceRef ref(item.second, dir);
+                bool fits = true;
+                for (int side = 0; side < 4; ++side) {
+                    fits = fits && ((ref.GetPattern(side) == 0) == outside[side]);
+                }
+                if (fits) {
+                    allowed[cell].push_back(ref);
+                }
+            }
+        }
+    }
+
+    // NE by its west, SW by its north, SE by both
+    std::vector< std::vector< PieceRef > > north_east(colors), south_west(colors), south_east(colors * colors);
+    for (auto& ref : allowed[1]) {
+        north_east[ref.GetPattern(WEST)].push_back(ref);
+    }
+    for (auto& ref : allowed[2]) {
+        south_west[ref.GetPattern(NORTH)].push_back(ref);
+    }
+    for (auto& ref : allowed[3]) {
+        south_east[ref.GetPattern(NORTH) * colors + ref.GetPattern(WEST)].push_back(ref);
+    }
+
+    // tiles are enumerated twice, first only counted by key, then stored right
+    // into their place in the table, so that nothing but the table itself (and
+    // positions within it) takes memory of the budget
+    size_t offsets_size = static_cast<size_t>(colors) * colors * colors * colors + 1;
+    memory += offsets_size * sizeof(uint32_t);
+    table.offsets.assign(offsets_size, 0);
+    std::vector<uint32_t> next; // position of next tile of each key
+    size_t count = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (auto& nw : allowed[0]) {
+            for (auto& ne : north_east[nw.GetPattern(EAST)]) {
+                if (ne.GetId() == nw.GetId()) {
+                    continue;
+                }
+                for (auto& sw : south_west[nw.GetPattern(SOUTH)]) {
+                    if (sw.GetId() == nw.GetId() || sw.GetId() == ne.GetId()) {
+                        continue;
+                    }
+                    for (auto& se : south_east[ne.GetPattern(SOUTH) * colors + sw.GetPattern(EAST)]) {
+                        if (se.GetId() == nw.GetId() || se.GetId() == ne.GetId() || se.GetId() == sw.GetId()) {
+                            continue;
+                        }
+                        int key = Key(nw.GetPattern(NORTH), ne.GetPattern(NORTH),
+                            nw.GetPattern(WEST), sw.GetPattern(WEST));
+                        if (pass == 0) {
+                            if (memory + offsets_size * sizeof(uint32_t) + (count + 1) * sizeof(Tile) > budget) {
+                                throw std::exception("Tiles do not fit into memory budget!");
+                            }
+                            ++table.offsets[key + 1];
+                            ++count;
+                            continue;
+                        }
+
+                        // grouped by key, in the order of enumeration within the group
+                        Tile& tile = table.tiles[next[key]++];
+                        const PieceRef* refs[4] = { &nw, &ne, &sw, &se };
+                        tile.dirs = 0;
+                        for (int cell = 0; cell < 4; ++cell) {
+                            tile.ids[cell] = static_cast<uint16_t>(refs[cell]->GetId());
+                            tile.dirs |= static_cast<uint8_t>(refs[cell]->GetDir() << (2 * cell));
+                        }
+                        tile.south[0] = static_cast<uint8_t>(sw.GetPattern(SOUTH));
+                        tile.south[1] = static_cast<uint8_t>(se.GetPattern(SOUTH));
+                        tile.east[0] = static_cast<uint8_t>(ne.GetPattern(EAST));
+                        tile.east[1] = static_cast<uint8_t>(se.GetPattern(EAST));
+                    }
+                }
+            }
+        }
+
+        if (pass == 0) {
+            for (size_t key = 1; key < offsets_size; ++key) {
+                table.offsets[key] += table.offsets[key - 1];
+            }
+            table.tiles.resize(count);
+            next.assign(table.offsets.begin(), table.offsets.end() - 1);
+        }
+    }
+    memory += count * sizeof(Tile);
+}
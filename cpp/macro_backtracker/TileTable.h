@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "PuzzleDef.h"
+
+namespace edge {
+
+namespace backtracker {
+
+// All valid 2x2 arrangements (tiles) of distinct pieces for every block of
+// the board, i.e. locations (2 * bx + i, 2 * by + j), with inner edges of the
+// tile matching, border patterns facing out and hints in place. Blocks of the
+// same kind (position towards the border) without hints share one table.
+// Tiles are grouped by their north and west patterns, which are known when
+// blocks are filled in row-major order.
+class TileTable
+{
+public:
+    // cells of a tile in order NW, NE, SW, SE
+    struct Tile {
+        uint16_t ids[4];
+        uint8_t dirs; // 2 bits per cell, first in the lowest ones
+        uint8_t south[2]; // of SW, SE
+        uint8_t east[2]; // of NE, SE
+
+        int GetDir(int cell) const
+        {
+            return (dirs >> (2 * cell)) & 3;
+        }
+    };
+
+    // throws if the board has odd size or tiles take more than budget bytes
+    TileTable(const PuzzleDef* def, size_t budget);
+
+    int GetBlockHeight() const;
+
+    int GetBlockWidth() const;
+
+    // tiles of block with given patterns facing north (of NW, NE) and west
+    // (of NW, SW)
+    void GetTiles(int bx, int by, int north0, int north1, int west0, int west1,
+        const Tile*& begin, const Tile*& end) const;
+
+    size_t GetTileCount() const;
+
+    size_t GetMemory() const;
+
+private:
+    struct Table {
+        std::vector< uint32_t > offsets; // by key, into tiles
+        std::vector< Tile > tiles;
+    };
+
+    int Key(int north0, int north1, int west0, int west1) const
+    {
+        return ((north0 * colors + north1) * colors + west0) * colors + west1;
+    }
+
+    void Build(int bx, int by, Table& table);
+
+    const PuzzleDef* def;
+    int colors; // patterns are below this
+    int block_height, block_width;
+    std::vector< int > block_tables; // by block, index into tables
+    std::vector< Table > tables;
+    size_t budget;
+    size_t memory;
+
+};
+
+}
+
+}
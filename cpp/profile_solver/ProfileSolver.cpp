@@ -0,0 +1,195 @@
+#include <exception>
+#include <map>
+#include "ProfileSolver.h"
+
+using namespace edge::backtracker;
+
+ProfileSolver::ProfileSolver(Board& board, int memo_mb)
+    : board(board), on_solve(nullptr), states(0), hits(0)
+{
+    auto def = board.GetPuzzleDef();
+    height = def->GetHeight();
+    width = def->GetWidth();
+
+    // hints, placed the same way as by backtrackers
+    hints.assign(height * width, nullptr);
+    std::vector<bool> hinted(def->GetPieceCount() + 1, false);
+    for (auto& hint : def->GetHints()) {
+        int dir = (hint.dir != -1) ? hint.dir : 0;
+        board.PutPiece(hint.id, hint.x, hint.y, dir);
+        hints[hint.x * width + hint.y] = &hint;
+        hinted[hint.id] = true;
+    }
+
+    // pieces of the same kind have equal patterns up to rotation, the kind is
+    // identified by the lowest of their rotated packed patterns
+    colors = 1;
+    std::map<uint32_t, int> kinds;
+    for (auto& item : def->GetAll()) {
+        for (int i = 0; i < 4; ++i) {
+            colors = std::max(colors, item.second.patterns[i] + 1);
+        }
+        if (hinted[item.first]) {
+            continue;
+        }
+        uint32_t lowest = PieceRef(item.second, 0).GetPatterns();
+        for (int dir = 1; dir < 4; ++dir) {
+            lowest = std::min(lowest, PieceRef(item.second, dir).GetPatterns());
+        }
+        auto kind = kinds.find(lowest);
+        if (kind == kinds.end()) {
+            kind = kinds.insert(std::make_pair(lowest, static_cast<int>(kind_ids.size()))).first;
+            kind_ids.push_back(std::vector<int>());
+        }
+        kind_ids[kind->second].push_back(item.first);
+    }
+
+    bits = 1;
+    while ((1 << bits) < colors) {
+        ++bits;
+    }
+    if ((width + 1) * bits > 128) {
+        throw std::exception("Board too wide for profile of 128 bits!");
+    }
+
+    // border patterns are 0 and only there, location on south and east border
+    // gets candidates with those patterns 0, north and west come from profile
+    for (int border = 0; border < 4; ++border) {
+        candidates[border].resize(colors * colors);
+    }
+    remaining.resize(kind_ids.size());
+    remaining_hash[0] = remaining_hash[1] = 0;
+    for (int kind = 0; kind < static_cast<int>(kind_ids.size()); ++kind) {
+        remaining[kind] = static_cast<int>(kind_ids[kind].size());
+        remaining_hash[0] ^= GetKey(kind, remaining[kind], 0);
+        remaining_hash[1] ^= GetKey(kind, remaining[kind], 1);
+        auto piece_def = def->GetPieceDef(kind_ids[kind][0]);
+        for (int dir = 0; dir < 4; ++dir) {
+            PieceRef ref(piece_def, dir);
+            Candidate candidate{ kind, dir, ref.GetPattern(SOUTH), ref.GetPattern(EAST) };
+            int border = ((candidate.south == 0) ? 2 : 0) | ((candidate.east == 0) ? 1 : 0);
+            candidates[border][ref.GetPattern(NORTH) * colors + ref.GetPattern(WEST)].push_back(candidate);
+        }
+    }
+
+    profile.assign(width + 1, 0);
+    memo_capacity = (static_cast<size_t>(memo_mb) << 20) / (sizeof(Key) + 4 * sizeof(uint64_t));
+}
+
+uint64_t ProfileSolver::Count()
+{
+    return Solve(0);
+}
+
+void ProfileSolver::RegisterOnSolve(CallbackOnSolve* callback)
+{
+    on_solve = callback;
+}
+
+long long ProfileSolver::GetStates() const
+{
+    return states;
+}
+
+long long ProfileSolver::GetHits() const
+{
+    return hits;
+}
+
+size_t ProfileSolver::GetMemoSize() const
+{
+    return memo.size();
+}
+
+uint64_t ProfileSolver::Solve(int pos)
+{
+    if (pos == height * width) {
+        if (on_solve) {
+            on_solve->Call(board);
+        }
+        return 1;
+    }
+
+    Key key = GetKey(pos);
+    auto found = memo.find(key);
+    if (found != memo.end()) {
+        // solutions to be handed over are searched again, dead ends are not
+        if (!on_solve || found->second == 0) {
+            ++hits;
+            return found->second;
+        }
+    }
+    ++states;
+
+    int x = pos / width;
+    int y = pos % width;
+    int north = profile[y];
+    int west = profile[width];
+    uint64_t count = 0;
+    if (hints[pos]) {
+        auto ref = board.GetLocation(x, y)->ref;
+        int south = ref->GetPattern(SOUTH);
+        int east = ref->GetPattern(EAST);
+        if (ref->GetPattern(NORTH) == north && ref->GetPattern(WEST) == west &&
+            (south == 0) == (x == height - 1) && (east == 0) == (y == width - 1)) {
+            profile[y] = south;
+            profile[width] = east;
+            count = Solve(pos + 1);
+            profile[y] = north;
+            profile[width] = west;
+        }
+    }
+    else {
+        int border = ((x == height - 1) ? 2 : 0) | ((y == width - 1) ? 1 : 0);
+        for (auto& candidate : candidates[border][north * colors + west]) {
+            int& left = remaining[candidate.piece];
+            if (left == 0) {
+                continue;
+            }
+            remaining_hash[0] ^= GetKey(candidate.piece, left, 0) ^ GetKey(candidate.piece, left - 1, 0);
+            remaining_hash[1] ^= GetKey(candidate.piece, left, 1) ^ GetKey(candidate.piece, left - 1, 1);
+            --left;
+            profile[y] = candidate.south;
+            profile[width] = candidate.east;
+            if (on_solve) {
+                board.PutPiece(kind_ids[candidate.piece][left], x, y, candidate.dir);
+            }
+
+            // any of the remaining pieces of the kind can go here
+            count += static_cast<uint64_t>(left + 1) * Solve(pos + 1);
+
+            if (on_solve) {
+                board.RemovePiece(board.GetLocation(x, y));
+            }
+            profile[y] = north;
+            profile[width] = west;
+            ++left;
+            remaining_hash[0] ^= GetKey(candidate.piece, left, 0) ^ GetKey(candidate.piece, left - 1, 0);
+            remaining_hash[1] ^= GetKey(candidate.piece, left, 1) ^ GetKey(candidate.piece, left - 1, 1);
+        }
+    }
+
+    if (memo.size() < memo_capacity) {
+        memo[key] = count;
+    }
+    return count;
+}
+
+ProfileSolver::Key ProfileSolver::GetKey(int pos) const
+{
+    Key key = { { 0, 0 }, { remaining_hash[0], remaining_hash[1] }, pos };
+    for (int i = 0; i <= width; ++i) {
+        int shift = i * bits;
+        key.profile[shift / 64] |= static_cast<uint64_t>(profile[i]) << (shift % 64);
+        if (shift % 64 + bits > 64) {
+            key.profile[shift / 64 + 1] |= static_cast<uint64_t>(profile[i]) >> (64 - shift % 64);
+        }
+    }
+    return key;
+}
+
+uint64_t ProfileSolver::GetKey(int kind, int remaining, int half)
+{
+    return MixHash((static_cast<uint64_t>(half) << 62) | (static_cast<uint64_t>(kind) << 32) |
+        static_cast<uint64_t>(remaining));
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Board.h"
+#include "CallbackOnSolve.h"
+
+namespace edge {
+
+namespace backtracker {
+
+// Counts all solutions by dynamic programming over locations in row-major
+// order. The state after placing a prefix of the locations is the profile
+// (patterns facing down from the last placed location of every column and the
+// one facing right from the last placed location) together with the multiset
+// of remaining pieces, number of completions of a state is kept in memo, so
+// every state is searched only once. Pieces with the same patterns (up to
+// rotation) are interchangeable and counted by multiplicity.
+class ProfileSolver
+{
+public:
+    // hints of the definition are placed on the board, memo takes up to
+    // memo_mb MB, states beyond it are searched again when reached
+    ProfileSolver(Board& board, int memo_mb);
+
+    // number of all solutions (modulo 2^64), pieces with equal patterns
+    // swapped give distinct solutions
+    uint64_t Count();
+
+    // solutions are also placed on the board and handed to the callback, one
+    // for every arrangement of patterns, i.e. with equal pieces not swapped
+    void RegisterOnSolve(CallbackOnSolve* callback);
+
+    // states searched, i.e. not found in memo
+    long long GetStates() const;
+
+    long long GetHits() const;
+
+    size_t GetMemoSize() const;
+
+private:
+    struct Candidate {
+        int piece; // index of piece kind
+        int dir;
+        int south, east;
+    };
+
+    struct Key {
+        uint64_t profile[2];
+        uint64_t remaining[2];
+        int pos; // hints do not change remaining pieces, so they do not tell it
+
+        bool operator==(const Key& other) const
+        {
+            return profile[0] == other.profile[0] && profile[1] == other.profile[1] &&
+                remaining[0] == other.remaining[0] && remaining[1] == other.remaining[1] &&
+                pos == other.pos;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const
+        {
+            return static_cast<size_t>(key.remaining[0] ^
+                MixHash(key.profile[0] ^ key.profile[1] ^ (static_cast<uint64_t>(key.pos) << 48)));
+        }
+    };
+
+    uint64_t Solve(int pos);
+
+    Key GetKey(int pos) const;
+
+    // Zobrist key of piece kind with given number of pieces remaining
+    static uint64_t GetKey(int kind, int remaining, int half);
+
+    Board& board;
+    int height, width;
+    int bits; // per pattern in packed profile
+    std::vector< std::vector< int > > kind_ids; // piece ids of every kind
+    std::vector< int > remaining; // by kind
+    uint64_t remaining_hash[2];
+    int colors; // patterns are below this
+    // by (south, east) on border, then by north * colors + west
+    std::vector< std::vector< Candidate > > candidates[4];
+    std::vector< const HintDef* > hints; // by location, null if none
+    std::vector< int > profile; // width patterns facing down, then the one facing right
+    std::unordered_map< Key, uint64_t, KeyHash > memo;
+    size_t memo_capacity;
+    CallbackOnSolve* on_solve;
+    long long states;
+    long long hits;
+
+};
+
+}
+
+}
@@ -0,0 +1,79 @@
+#include <sstream>
+#include "PuzzleDef.h"
+#include "Board.h"
+#include "ProfileSolver.h"
+#include "Args.h"
+#include <time.h>
+
+class Solved : public edge::backtracker::CallbackOnSolve {
+public:
+    Solved(const std::string& prefix) : prefix(prefix), counter(0)
+    {
+    }
+
+    void Call(edge::Board& board)
+    {
+        if (counter < 20)
+        {// safety mechanism, do not save more than certain number of solutions...
+            std::stringstream ss;
+            ss << prefix << "_save_" << "solved_" << counter + 1 << ".csv";
+            board.Save(ss.str());
+        }
+        ++counter;
+    }
+
+    int GetCount() const
+    {
+        return counter;
+    }
+
+private:
+    std::string prefix;
+    int counter;
+};
+
+int main(int argc, char* argv[])
+{
+    // positional arguments: definition, [hints]
+    edge::Args args(argc, argv);
+    auto& positional = args.GetPositional();
+    if (positional.empty()) {
+        printf("Missing puzzle definition argument\n");
+        return 1;
+    }
+
+    std::string def_file = positional[0];
+    std::string hints_file = "";
+    if (positional.size() > 1) {
+        hints_file = positional[1];
+    }
+
+    // --memo-mb=N limits memory of counted states (default 1024)
+    int memo_mb = args.GetInt("memo-mb", 1024);
+
+    // --save=PREFIX saves first 20 solutions (up to swapping equal pieces),
+    // which makes the search visit every solution instead of counting
+    std::string save_prefix = args.Get("save");
+
+    edge::PuzzleDef def = edge::PuzzleDef::Load(def_file, hints_file);
+    edge::Board board(&def);
+
+    edge::backtracker::ProfileSolver solver(board, memo_mb);
+    Solved solved_callback(save_prefix);
+    if (!save_prefix.empty()) {
+        solver.RegisterOnSolve(&solved_callback);
+    }
+
+    clock_t start = clock();
+    uint64_t count = solver.Count();
+    double seconds = static_cast<double>(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("solutions: %llu\n", static_cast<unsigned long long>(count));
+    if (!save_prefix.empty()) {
+        printf("arrangements: %i\n", solved_callback.GetCount());
+    }
+    printf("states: %lli, memo hits: %lli, memo entries: %llu, time: %.2f sec\n",
+        solver.GetStates(), solver.GetHits(), static_cast<unsigned long long>(solver.GetMemoSize()), seconds);
+
+    return 0;
+}
@@ -44,6 +44,12 @@ Swapper::Swapper(Board& board)
     }
 
     max_score = board.GetScore();
+    best_mark = board.Mark();
+}
+
+Swapper::~Swapper()
+{
+    board.Commit();
 }
 
 void Swapper::DoSwap()
@@ -58,7 +64,8 @@ void Swapper::DoSwap()
             LINFO("Best score improved to %i\n", score);
             max_score = score;
             quick_swapping_counter = 3;
-            board_backup = board.Backup();
+            board.Commit();
+            best_mark = board.Mark();
         }
         else {
             quick_swapping_counter -= 1;
@@ -98,8 +105,8 @@ void Swapper::DoSwap()
             recovering_counter -= 1;
             if (recovering_counter >= 0) {
                 LDEBUG("RANDOM_RECOVERING not successful, going back to RANDOM_SHUFFLING\n");
-                if (score < max_score && !board_backup.board.empty()) {
-                    board.Restore(board_backup);
+                if (score < max_score) {
+                    board.RollbackTo(best_mark);
                 }
                 state = State::RANDOM_SHUFFLING;
             }
@@ -234,41 +241,26 @@ bool Swapper::DoQuickSwapsEdges(int score_to_beat, std::vector<
         {
             auto& loc2 = locs[cont[idx[idx2]]];
 
-            int piece_score_before = board.GetScore(loc1);
-            piece_score_before += board.GetScore(loc2);
-            if (HaveCommonEdge(loc1, loc2)) {
-                piece_score_before -= 1;
-            }
-
-            int orig_dir1 = loc1->ref->GetDir();
-            int orig_dir2 = loc2->ref->GetDir();
+            auto mark = board.Mark();
             board.SwapLocations(loc1, loc2);
             board.AdjustDirBorderSingle(loc1);
             board.AdjustDirBorderSingle(loc2);
 
-            int piece_score_after = board.GetScore(loc1);
-            piece_score_after += board.GetScore(loc2);
-            if (HaveCommonEdge(loc1, loc2)) {
-                piece_score_after -= 1;
-            }
-
-            if (piece_score_after > piece_score_before)
+            // board keeps its score up to date, no need to count the pieces
+            int after = board.GetScore();
+            if (after > score_before)
             {
                 return true;
             }
 
-            // convert local score to global
-            auto diff = piece_score_after - piece_score_before;
-            if (score_before + diff == score_to_beat)
+            if (after == score_to_beat)
             {
                 same_score_pieces_pairs.push_back(
                     std::pair<Board::Loc*,
                     Board::Loc* >(loc1, loc2));
             }
 
-            board.SwapLocations(loc1, loc2);
-            board.ChangeDir(loc1, orig_dir1);
-            board.ChangeDir(loc2, orig_dir2);
+            board.RollbackTo(mark);
         }
     }
 
@@ -289,94 +281,70 @@ bool Swapper::DoQuickSwapsInners(int score_to_beat, std::vector<
     }
     std::stable_sort(idx.begin(), idx.end(),
         [&vals](size_t i1, size_t i2) {return vals[i1] < vals[i2]; });
+    auto score_before = board.GetScore();
     for (size_t idx1 = 1; idx1 < idx.size(); ++idx1)
     {
         auto loc1 = locs[cont[idx[idx1]]];
         for (size_t idx2 = 0; idx2 < idx1 && vals[idx[idx2]] < 4; ++idx2)
         {
             auto loc2 = locs[cont[idx[idx2]]];
-            int orig_dir1 = loc1->ref->GetDir();
-            int orig_dir2 = loc2->ref->GetDir();
-            int piece_score_before = board.GetScore(loc1);
-            piece_score_before += board.GetScore(loc2);
-            if (HaveCommonEdge(loc1, loc2)) {
-                piece_score_before -= 1;
+            auto mark = board.Mark();
+
+            // exchanged pieces are scored in all rotations without placing
+            // them, each against the rest of the board, and against each
+            // other if they are neighbours
+            int id1 = loc1->ref->GetId();
+            int id2 = loc2->ref->GetId();
+            board.RemovePiece(loc1);
+            board.RemovePiece(loc2);
+            int rest = board.GetScore();
+            int common = -1;
+            for (int dir = 0; dir < 4; ++dir) {
+                if (board.GetNeighbour(loc1, dir) == loc2) {
+                    common = dir;
+                }
+            }
+            int scores2[4];
+            for (int dir2 = 0; dir2 < 4; ++dir2) {
+                scores2[dir2] = board.GetScore(loc2, board.GetRef(id1, dir2));
             }
-
-            board.SwapLocations(loc1, loc2);
-            int piece_score_best_after = piece_score_before;
 
             for (int dir1 = 0; dir1 < 4; ++dir1) {
+                auto ref1 = board.GetRef(id2, dir1);
+                int score1 = rest + board.GetScore(loc1, ref1);
                 for (int dir2 = 0; dir2 < 4; ++dir2) {
-                    board.ChangeDir(loc1, dir1);
-                    board.ChangeDir(loc2, dir2);
-                    int piece_score_after = board.GetScore(loc1);
-                    piece_score_after += board.GetScore(loc2);
-                    if (HaveCommonEdge(loc1, loc2)) {
-                        piece_score_after -= 1;
+                    auto ref2 = board.GetRef(id1, dir2);
+                    int after = score1 + scores2[dir2];
+                    if (common != -1 &&
+                        ref1->GetPattern(common) == ref2->GetPattern((common + 2) % 4)) {
+                        after += 1;
                     }
 
-                    if (piece_score_after > piece_score_best_after) {
+                    if (after > score_before) {
                         LDEBUG("Switching (%i, %i) <-> (%i, %i), score %i to %i\n",
                             loc1->x, loc1->y, loc2->x, loc2->y,
-                            piece_score_before, piece_score_after);
-                        piece_score_best_after = piece_score_after;
+                            score_before, after);
+                        board.PutPiece(loc1, ref1);
+                        board.PutPiece(loc2, ref2);
                         board.AdjustDirInner();
                         return true;
                     }
 
-                    if (piece_score_after == piece_score_before) {
+                    if (after == score_before) {
                         same_score_pieces_pairs.push_back(
                             std::pair<Board::Loc*,
                             Board::Loc* >(loc1, loc2));
                     }
-
                 }
             }
 
-            board.SwapLocations(loc1, loc2);
-            board.ChangeDir(loc1, orig_dir1);
-            board.ChangeDir(loc2, orig_dir2);
+            board.RollbackTo(mark);
         }
     }
 
     return false;
 }
 
-bool Swapper::HaveCommonEdge(Board::Loc* loc1,
-    Board::Loc* loc2)
-{
-    if (loc1->y == loc2->y) {
-        if (loc1->x + 1 == loc2->x) {
-            // inner2 is below inner1
-            if (loc1->ref->GetPattern(SOUTH) == loc2->ref->GetPattern(NORTH)) {
-                return true;
-            }
-        }
-        else if (loc2->x + 1 == loc1->x) {
-            // inner1 is below inner2
-            if (loc1->ref->GetPattern(NORTH) == loc2->ref->GetPattern(SOUTH)) {
-                return true;
-            }
-        }
-    }
-    else if (loc1->x == loc2->x) {
-        if (loc1->y + 1 == loc2->y) {
-            // inner2 is right to inner1
-            if (loc1->ref->GetPattern(EAST) == loc2->ref->GetPattern(WEST)) {
-                return true;
-            }
-        }
-        else if (loc2->y + 1 == loc1->y) {
-            // inner1 is right to inner2
-            if (loc1->ref->GetPattern(WEST) == loc2->ref->GetPattern(EAST)) {
-                return true;
-            }
-        }
-    }
-    return false;
-}
-
 void Swapper::Shuffle()
 {
     // shuffle random pieces
@@ -400,10 +368,15 @@ void Swapper::Shuffle(std::vector< int >& ids, int count)
     std::iota(indicies.begin(), indicies.end(), 0);
     std::random_shuffle(indicies.begin(), indicies.end());
     auto& locs = board.GetLocations();
-    auto first = std::move(locs[ids[indicies[0]]]->ref);
+    std::vector<Board::Loc*> cycle(count);
+    for (int i = 0; i < count; ++i) {
+        cycle[i] = locs[ids[indicies[i]]];
+    }
+
+    // each location gets piece of the next one, the last one that of the first,
+    // through the board so that its index and score stay consistent
     for (int i = 0; i < count - 1; ++i) {
-        locs[ids[indicies[i]]]->ref = std::move(locs[ids[indicies[i + 1]]]->ref);
+        board.SwapLocations(cycle[i], cycle[i + 1]);
     }
-    locs[ids[indicies[count - 1]]]->ref = std::move(first);
 }
 
@@ -9,6 +9,8 @@ class Swapper
 public:
     Swapper(Board& board);
 
+    ~Swapper();
+
     void DoSwap();
 
 private:
@@ -33,9 +35,6 @@ private:
         std::pair<Board::Loc*,
         Board::Loc*>>&same_score_pieces_pairs);
 
-    bool HaveCommonEdge(Board::Loc* loc1,
-        Board::Loc* loc2);
-
     void Shuffle();
 
     void Shuffle(std::vector< int >& ids, int count);
@@ -52,7 +51,7 @@ private:
     std::vector< int > swappable_inners;
 
     Board& board;
-    Board::State board_backup;
+    size_t best_mark; // changes since the best board are recorded from here
     State state;
     int max_score;
     int score_before;